@@ -0,0 +1,241 @@
+//
+//  Main.cpp
+//  Simple EQ Batch Renderer
+//
+//  Copyright © 2022 Hsian. All rights reserved.
+//
+
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+
+/*
+ Headless offline renderer: runs WAV/AIFF files through SimpleEQAudioProcessor
+ with a state saved by getStateInformation(), one file per job, as many jobs
+ in parallel as there are cores.
+
+     SimpleEQBatchRenderer --state=preset.state --output=rendered/ [--jobs=N] [--block=N] [--double] files or folders...
+ */
+namespace {
+    struct RenderSettings {
+        juce::MemoryBlock state;
+        juce::File outputDirectory;
+        int blockSize = 8192;
+        bool doublePrecision = false;
+    };
+
+    struct RenderResult {
+        juce::String error;
+        double secondsOfAudio = 0.0;
+        // Counted by the RealtimeSafety traps, which this executable is built with.
+        juce::uint64 numAllocations = 0, numLocks = 0;
+    };
+
+    // Memory-mapped where the format supports it, streamed otherwise.
+    std::unique_ptr<juce::AudioFormatReader> openReader(juce::AudioFormat& format, const juce::File& file){
+        std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped(format.createMemoryMappedReader(file));
+        if (mapped != nullptr && mapped->mapEntireFile()){
+            return mapped;
+        }
+        auto stream = file.createInputStream();
+        if (stream == nullptr){
+            return nullptr;
+        }
+        std::unique_ptr<juce::AudioFormatReader> reader(format.createReaderFor(stream.get(), true));
+        if (reader != nullptr){
+            stream.release();
+        }
+        return reader;
+    }
+
+    RenderResult renderFile(const juce::File& input, const RenderSettings& settings, juce::AudioFormatManager& formats){
+        RenderResult result;
+        auto* format = formats.findFormatForFileExtension(input.getFileExtension());
+        if (format == nullptr){
+            result.error = "unsupported file type";
+            return result;
+        }
+        auto reader = openReader(*format, input);
+        if (reader == nullptr){
+            result.error = "could not be read";
+            return result;
+        }
+        const auto numChannels = (int) reader->numChannels;
+        const auto sampleRate = reader->sampleRate;
+        const auto blockSize = settings.blockSize;
+
+        SimpleEQAudioProcessor processor;
+        processor.setNonRealtime(true);
+        processor.setProcessingPrecision(settings.doublePrecision ? juce::AudioProcessor::doublePrecision
+                                                                  : juce::AudioProcessor::singlePrecision);
+        processor.setPlayConfigDetails(numChannels, numChannels, sampleRate, blockSize);
+        if (processor.getTotalNumInputChannels() != numChannels){
+            result.error = "unsupported channel count";
+            return result;
+        }
+        processor.setStateInformation(settings.state.getData(), (int) settings.state.getSize());
+        // Designs the coefficients (and the linear-phase kernel) synchronously, so the first block is already right.
+        processor.prepareToPlay(sampleRate, blockSize);
+
+        auto output = settings.outputDirectory.getChildFile(input.getFileName());
+        output.deleteFile();
+        auto stream = std::make_unique<juce::FileOutputStream>(output);
+        if (stream->failedToOpen()){
+            result.error = "could not create " + output.getFullPathName();
+            return result;
+        }
+        std::unique_ptr<juce::AudioFormatWriter> writer(format->createWriterFor(stream.get(), sampleRate, (unsigned int) numChannels,
+                                                                                (int) reader->bitsPerSample, reader->metadataValues, 0));
+        if (writer == nullptr){
+            result.error = "could not create a writer for " + output.getFullPathName();
+            return result;
+        }
+        stream.release();
+
+        // The reader pads with silence past the end, which flushes the latency out of
+        // the processor; the same number of samples is skipped at the start so the
+        // output lines up with the input.
+        const auto latency = (juce::int64) processor.getLatencySamples();
+        const auto totalSamples = reader->lengthInSamples + latency;
+        juce::AudioBuffer<float> buffer(numChannels, blockSize);
+        juce::AudioBuffer<double> doubleBuffer(settings.doublePrecision ? numChannels : 0, blockSize);
+        juce::MidiBuffer midi;
+        for (juce::int64 position = 0; position < totalSamples; position += blockSize){
+            const auto numSamples = (int) juce::jmin((juce::int64) blockSize, totalSamples - position);
+            buffer.setSize(numChannels, numSamples, false, false, true);
+            reader->read(&buffer, 0, numSamples, position, true, true);
+            if (settings.doublePrecision){
+                doubleBuffer.makeCopyOf(buffer, true);
+                processor.processBlock(doubleBuffer, midi);
+                buffer.makeCopyOf(doubleBuffer, true);
+            } else {
+                processor.processBlock(buffer, midi);
+            }
+            const auto skip = (int) juce::jlimit((juce::int64) 0, (juce::int64) numSamples, latency - position);
+            if (!writer->writeFromAudioSampleBuffer(buffer, skip, numSamples - skip)){
+                result.error = "write failed";
+                return result;
+            }
+        }
+        const auto report = processor.getRealtimeReport();
+        result.numAllocations = report.numAllocations;
+        result.numLocks = report.numLocks;
+        processor.releaseResources();
+        result.secondsOfAudio = (double) reader->lengthInSamples / sampleRate;
+        return result;
+    }
+
+    struct RenderJob : juce::ThreadPoolJob {
+        RenderJob(const juce::File& file, const RenderSettings& renderSettings, juce::AudioFormatManager& formatManager,
+                  RenderResult& renderResult, juce::CriticalSection& logLock)
+            : juce::ThreadPoolJob(file.getFileName()), input(file), settings(renderSettings), formats(formatManager),
+              result(renderResult), lock(logLock) {}
+
+        JobStatus runJob() override{
+            result = renderFile(input, settings, formats);
+            const juce::ScopedLock sl(lock);
+            std::cout << (result.error.isEmpty() ? "done    " : "FAILED  ") << input.getFullPathName();
+            if (result.error.isNotEmpty()){
+                std::cout << ": " << result.error;
+            } else if (RealtimeSafety::isEnabled && result.numAllocations + result.numLocks > 0){
+                std::cout << " (" << result.numAllocations << " allocations, " << result.numLocks << " locks inside processBlock)";
+            }
+            std::cout << std::endl;
+            return jobHasFinished;
+        }
+    private:
+        juce::File input;
+        const RenderSettings& settings;
+        juce::AudioFormatManager& formats;
+        RenderResult& result;
+        juce::CriticalSection& lock;
+    };
+
+    void printUsage(){
+        std::cout << "usage: SimpleEQBatchRenderer --state=<file> --output=<folder> [--jobs=N] [--block=N] [--double] <files or folders>..." << std::endl
+                  << "  --state   parameter state in the format written by getStateInformation()" << std::endl
+                  << "  --output  where rendered files go, under their original names" << std::endl
+                  << "  --jobs    files rendered in parallel (default: one per core)" << std::endl
+                  << "  --block   samples per processBlock() call (default: 8192)" << std::endl
+                  << "  --double  process in double precision" << std::endl;
+    }
+}
+
+int main (int argc, char* argv[])
+{
+    // The processor's parameters and timers expect a message manager, even without an editor.
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList args(argc, argv);
+    if (args.size() == 0 || args.containsOption("--help|-h")){
+        printUsage();
+        return 0;
+    }
+
+    RenderSettings settings;
+    const auto stateFile = juce::File::getCurrentWorkingDirectory().getChildFile(args.removeValueForOption("--state"));
+    if (!stateFile.existsAsFile() || !stateFile.loadFileAsData(settings.state)){
+        std::cerr << "could not read the state file " << stateFile.getFullPathName() << std::endl;
+        return 1;
+    }
+    settings.outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(args.removeValueForOption("--output"));
+    if (!settings.outputDirectory.createDirectory()){
+        std::cerr << "could not create " << settings.outputDirectory.getFullPathName() << std::endl;
+        return 1;
+    }
+    const auto blockSize = args.removeValueForOption("--block").getIntValue();
+    settings.blockSize = blockSize > 0 ? juce::jlimit(32, 1 << 16, blockSize) : 8192;
+    auto numJobs = args.removeValueForOption("--jobs").getIntValue();
+    if (numJobs <= 0){
+        numJobs = juce::SystemStats::getNumCpus();
+    }
+    settings.doublePrecision = args.removeOptionIfFound("--double");
+
+    juce::Array<juce::File> inputs;
+    for (auto& argument: args.arguments){
+        auto file = argument.resolveAsFile();
+        if (file.isDirectory()){
+            inputs.addArray(file.findChildFiles(juce::File::findFiles, false, "*.wav;*.aif;*.aiff"));
+        } else if (file.existsAsFile()){
+            inputs.add(file);
+        } else {
+            std::cerr << "skipping " << argument.text << ": no such file" << std::endl;
+        }
+    }
+    for (auto& input: inputs){
+        if (input.getParentDirectory() == settings.outputDirectory){
+            std::cerr << "refusing to overwrite " << input.getFullPathName() << ": pick another output folder" << std::endl;
+            return 1;
+        }
+    }
+    // Longest files first, so a big one picked up last doesn't leave the other cores idle.
+    std::sort(inputs.begin(), inputs.end(), [](const juce::File& a, const juce::File& b){return a.getSize() > b.getSize();});
+
+    juce::AudioFormatManager formats;
+    formats.registerBasicFormats();
+    std::vector<RenderResult> results((size_t) inputs.size());
+    juce::CriticalSection logLock;
+
+    const auto startTime = juce::Time::getMillisecondCounterHiRes();
+    {
+        juce::ThreadPool pool(juce::jmin(numJobs, juce::jmax(1, inputs.size())));
+        for (int i = 0; i < inputs.size(); ++i){
+            pool.addJob(new RenderJob(inputs[i], settings, formats, results[(size_t) i], logLock), true);
+        }
+        while (pool.getNumJobs() > 0){
+            juce::Thread::sleep(20);
+        }
+    }
+    const auto elapsedSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+
+    int numRendered = 0;
+    double secondsOfAudio = 0.0;
+    for (auto& result: results){
+        if (result.error.isEmpty()){
+            ++numRendered;
+            secondsOfAudio += result.secondsOfAudio;
+        }
+    }
+    std::cout << "rendered " << numRendered << " of " << inputs.size() << " files (" << secondsOfAudio << " s of audio) in "
+              << elapsedSeconds << " s: " << numRendered * 3600.0 / juce::jmax(elapsedSeconds, 1.0e-3) << " files/hour, "
+              << secondsOfAudio / juce::jmax(elapsedSeconds, 1.0e-3) << "x realtime" << std::endl;
+    return numRendered == inputs.size() ? 0 : 1;
+}
@@ -0,0 +1,395 @@
+//
+//  Main.cpp
+//  Simple EQ Benchmark
+//
+//  Copyright © 2022 Hsian. All rights reserved.
+//
+
+#include <JuceHeader.h>
+#include <chrono>
+#include "../../Source/PluginProcessor.h"
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+/*
+ Times the DSP hot path over a matrix of settings and writes the results as JSON:
+
+     SimpleEQBenchmark [--output=results.json] [--baseline=previous.json] [--samples=N] [--quick]
+
+ Targets:
+  - processBlock: SimpleEQAudioProcessor::processBlock, with and without analyzer capture
+  - cascade:      the MultiChannelCascade the processor runs, on its own
+  - monoChain:    the reference juce::dsp::ProcessorChain (MonoChain), one per channel
+  - design:       makeChainCoefficients(), which the design thread runs on every parameter change
+                  (this replaced the per-block updateFilters())
+
+ With --baseline, entries more than 10% slower than in the given file are listed
+ and the exit code is 1.
+ */
+
+//==============================================================================
+namespace {
+    // rdtsc where there is one; elsewhere cycles are estimated from the nominal clock.
+    juce::uint64 readCycleCounter(){
+       #if JUCE_INTEL
+        return (juce::uint64) __rdtsc();
+       #else
+        return 0;
+       #endif
+    }
+    constexpr bool hasCycleCounter = JUCE_INTEL != 0;
+
+    double nowInNanoseconds(){
+        using namespace std::chrono;
+        return (double) duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    struct Measurement {
+        double nanoseconds = 0.0;
+        double cycles = 0.0;
+        juce::int64 allocations = 0;
+        int numSamples = 0;
+
+        // Allocations are counted by the RealtimeSafety traps (this executable is
+        // built with SIMPLE_EQ_REALTIME_CHECKS=1), on the benchmarking thread only.
+        // processBlock opens its own scope, which counts into the processor's stats.
+        // Time Release builds: in debug every counted allocation also asserts.
+        template<typename Function>
+        void add(Function&& function){
+            RealtimeSafety::Stats stats;
+            {
+                const RealtimeSafety::ScopedProcessBlock scope(stats, 0, 0.0);
+                const auto cyclesBefore = readCycleCounter();
+                const auto start = nowInNanoseconds();
+                function();
+                nanoseconds += nowInNanoseconds() - start;
+                cycles += (double) (readCycleCounter() - cyclesBefore);
+            }
+            allocations += (juce::int64) stats.numAllocations.load();
+        }
+        double getCycles() const {
+            return hasCycleCounter ? cycles : nanoseconds * juce::SystemStats::getCpuSpeedInMegahertz() * 1.0e-3;
+        }
+    };
+
+    struct Config {
+        juce::String target;
+        int blockSize = 512;
+        Slope slope = Slope_12;
+        int bypassMask = 0; // bit 0: low cut, bit 1: peak, bit 2: high cut
+        double sampleRate = 48000.0;
+        int numChannels = 2;
+        bool analyzer = false;
+
+        juce::String getName() const {
+            return target + "/block" + juce::String(blockSize) + "/slope" + juce::String(12 * (slope + 1))
+                   + "/bypass" + juce::String(bypassMask) + "/" + juce::String((int) sampleRate) + "Hz/"
+                   + juce::String(numChannels) + "ch" + (analyzer ? "/analyzer" : "");
+        }
+    };
+
+    void setParameter(juce::AudioProcessorValueTreeState& apvts, const juce::String& id, float value){
+        auto* parameter = apvts.getParameter(id);
+        jassert(parameter != nullptr);
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+    }
+
+    // Every band engaged unless bypassed, with the cuts well inside the audio band.
+    void applyConfig(juce::AudioProcessorValueTreeState& apvts, const Config& config){
+        setParameter(apvts, "LowCut Freq", 80.f);
+        setParameter(apvts, "HighCut Freq", 10000.f);
+        setParameter(apvts, "Peak Freq", 1000.f);
+        setParameter(apvts, "Peak Gain", 6.f);
+        setParameter(apvts, "Peak Quality", 1.f);
+        setParameter(apvts, "LowCut Slope", (float) config.slope);
+        setParameter(apvts, "HighCut Slope", (float) config.slope);
+        setParameter(apvts, "LowCut Bypassed", (config.bypassMask & 1) != 0 ? 1.f : 0.f);
+        setParameter(apvts, "Peak Bypassed", (config.bypassMask & 2) != 0 ? 1.f : 0.f);
+        setParameter(apvts, "HighCut Bypassed", (config.bypassMask & 4) != 0 ? 1.f : 0.f);
+        setParameter(apvts, "Analyzer Enabled", config.analyzer ? 1.f : 0.f);
+    }
+
+    // Blocks are cut from batches of fresh noise, so the filters never run on their own output.
+    // The batches stay well below the analyzer ring, which is drained between them, outside the timing.
+    constexpr int batchSize = 8192;
+
+    template<typename ProcessFunction, typename BetweenBatchesFunction>
+    Measurement runBlocks(const Config& config, int numSamples, const juce::AudioBuffer<float>& noise,
+                          juce::AudioBuffer<float>& batch, ProcessFunction&& process, BetweenBatchesFunction&& betweenBatches){
+        Measurement measurement;
+        const auto samplesPerBatch = juce::jmax(config.blockSize, batchSize / config.blockSize * config.blockSize);
+        for (int done = 0; done < numSamples; done += samplesPerBatch){
+            for (int ch = 0; ch < config.numChannels; ++ch){
+                batch.copyFrom(ch, 0, noise, ch, 0, samplesPerBatch);
+            }
+            measurement.add([&]{
+                for (int start = 0; start < samplesPerBatch; start += config.blockSize){
+                    juce::AudioBuffer<float> block(batch.getArrayOfWritePointers(), config.numChannels, start, config.blockSize);
+                    process(block);
+                }
+            });
+            measurement.numSamples += samplesPerBatch;
+            betweenBatches();
+        }
+        return measurement;
+    }
+
+    juce::var makeEntry(const Config& config, const Measurement& measurement){
+        const auto numSamples = (double) measurement.numSamples;
+        auto* entry = new juce::DynamicObject();
+        entry->setProperty("name", config.getName());
+        entry->setProperty("target", config.target);
+        entry->setProperty("blockSize", config.blockSize);
+        entry->setProperty("slope", 12 * (config.slope + 1));
+        entry->setProperty("lowCutBypassed", (config.bypassMask & 1) != 0);
+        entry->setProperty("peakBypassed", (config.bypassMask & 2) != 0);
+        entry->setProperty("highCutBypassed", (config.bypassMask & 4) != 0);
+        entry->setProperty("sampleRate", config.sampleRate);
+        entry->setProperty("numChannels", config.numChannels);
+        entry->setProperty("analyzer", config.analyzer);
+        entry->setProperty("nsPerSample", measurement.nanoseconds / numSamples);
+        entry->setProperty("cyclesPerSample", measurement.getCycles() / numSamples);
+        entry->setProperty("allocationsPerBlock", (double) measurement.allocations * config.blockSize / numSamples);
+        return entry;
+    }
+
+    juce::var benchmarkProcessBlock(const Config& config, int numSamples, const juce::AudioBuffer<float>& noise, juce::AudioBuffer<float>& batch){
+        SimpleEQAudioProcessor processor;
+        processor.setPlayConfigDetails(config.numChannels, config.numChannels, config.sampleRate, config.blockSize);
+        applyConfig(processor.apvts, config);
+        processor.prepareToPlay(config.sampleRate, config.blockSize);
+        if (config.analyzer){
+            processor.leftChannelFifo.addConsumer();
+            processor.rightChannelFifo.addConsumer();
+        }
+        std::vector<float> drained(batchSize);
+        auto drain = [&]{
+            for (auto* fifo: {&processor.leftChannelFifo, &processor.rightChannelFifo}){
+                while (fifo->pull(drained.data(), (int) drained.size()) > 0){}
+            }
+        };
+        juce::MidiBuffer midi;
+        auto process = [&](juce::AudioBuffer<float>& block){processor.processBlock(block, midi);};
+
+        runBlocks(config, batchSize, noise, batch, process, drain);
+        processor.resetRealtimeStats();
+        auto measurement = runBlocks(config, numSamples, noise, batch, process, drain);
+        measurement.allocations += (juce::int64) processor.getRealtimeReport().numAllocations;
+        if (config.analyzer){
+            processor.leftChannelFifo.removeConsumer();
+            processor.rightChannelFifo.removeConsumer();
+        }
+        processor.releaseResources();
+        return makeEntry(config, measurement);
+    }
+
+    ChainCoefficients makeConfigCoefficients(const Config& config){
+        SimpleEQAudioProcessor processor;
+        applyConfig(processor.apvts, config);
+        return makeChainCoefficients(getChainSettings(processor.apvts), config.sampleRate);
+    }
+
+    juce::var benchmarkCascade(const Config& config, int numSamples, const juce::AudioBuffer<float>& noise, juce::AudioBuffer<float>& batch){
+        MultiChannelCascade<float> cascade;
+        cascade.prepare(config.numChannels, config.blockSize);
+        cascade.setCoefficients(makeConfigCoefficients(config));
+        auto process = [&](juce::AudioBuffer<float>& buffer){
+            juce::dsp::AudioBlock<float> block(buffer);
+            cascade.process(block);
+        };
+        runBlocks(config, batchSize, noise, batch, process, []{});
+        return makeEntry(config, runBlocks(config, numSamples, noise, batch, process, []{}));
+    }
+
+    template<int Index>
+    void loadCutFilter(CutFilter& cut, const ChainCoefficients& coefficients, int firstStage){
+        const auto& c = coefficients.stages[(size_t) (firstStage + Index)];
+        *cut.template get<Index>().coefficients = juce::dsp::IIR::Coefficients<float>((float) c[0], (float) c[1], (float) c[2],
+                                                                                    1.f, (float) c[3], (float) c[4]);
+        cut.template setBypassed<Index>(!coefficients.active[(size_t) (firstStage + Index)]);
+    }
+
+    void loadMonoChain(MonoChain& chain, const ChainCoefficients& coefficients){
+        for (auto* cut: {&chain.get<ChainPositions::LowCut>(), &chain.get<ChainPositions::HighCut>()}){
+            const auto firstStage = cut == &chain.get<ChainPositions::LowCut>() ? LowCutFirstStage : HighCutFirstStage;
+            loadCutFilter<0>(*cut, coefficients, firstStage);
+            loadCutFilter<1>(*cut, coefficients, firstStage);
+            loadCutFilter<2>(*cut, coefficients, firstStage);
+            loadCutFilter<3>(*cut, coefficients, firstStage);
+        }
+        const auto& c = coefficients.stages[PeakStage];
+        *chain.get<ChainPositions::Peak>().coefficients = juce::dsp::IIR::Coefficients<float>((float) c[0], (float) c[1], (float) c[2],
+                                                                                            1.f, (float) c[3], (float) c[4]);
+        chain.setBypassed<ChainPositions::Peak>(!coefficients.active[PeakStage]);
+    }
+
+    juce::var benchmarkMonoChain(const Config& config, int numSamples, const juce::AudioBuffer<float>& noise, juce::AudioBuffer<float>& batch){
+        juce::OwnedArray<MonoChain> chains;
+        const auto coefficients = makeConfigCoefficients(config);
+        juce::dsp::ProcessSpec spec {config.sampleRate, (juce::uint32) config.blockSize, 1};
+        for (int ch = 0; ch < config.numChannels; ++ch){
+            auto* chain = chains.add(new MonoChain());
+            chain->prepare(spec);
+            loadMonoChain(*chain, coefficients);
+        }
+        auto process = [&](juce::AudioBuffer<float>& buffer){
+            juce::dsp::AudioBlock<float> block(buffer);
+            for (int ch = 0; ch < config.numChannels; ++ch){
+                auto channelBlock = block.getSingleChannelBlock((size_t) ch);
+                chains[ch]->process(juce::dsp::ProcessContextReplacing<float>(channelBlock));
+            }
+        };
+        runBlocks(config, batchSize, noise, batch, process, []{});
+        return makeEntry(config, runBlocks(config, numSamples, noise, batch, process, []{}));
+    }
+
+    juce::var benchmarkDesign(Slope slope, bool analogMatched, double sampleRate){
+        SimpleEQAudioProcessor processor;
+        Config config;
+        config.slope = slope;
+        applyConfig(processor.apvts, config);
+        setParameter(processor.apvts, "Analog Matched", analogMatched ? 1.f : 0.f);
+        const auto settings = getChainSettings(processor.apvts);
+
+        constexpr int numCalls = 2000;
+        Measurement measurement;
+        ChainCoefficients coefficients;
+        measurement.add([&]{
+            for (int i = 0; i < numCalls; ++i){
+                coefficients = makeChainCoefficients(settings, sampleRate);
+            }
+        });
+        juce::ignoreUnused(coefficients);
+
+        auto* entry = new juce::DynamicObject();
+        entry->setProperty("name", "design/slope" + juce::String(12 * (slope + 1)) + (analogMatched ? "/matched/" : "/") + juce::String((int) sampleRate) + "Hz");
+        entry->setProperty("target", "design");
+        entry->setProperty("slope", 12 * (slope + 1));
+        entry->setProperty("analogMatched", analogMatched);
+        entry->setProperty("sampleRate", sampleRate);
+        entry->setProperty("nsPerCall", measurement.nanoseconds / numCalls);
+        entry->setProperty("cyclesPerCall", measurement.getCycles() / numCalls);
+        entry->setProperty("allocationsPerCall", (double) measurement.allocations / numCalls);
+        return entry;
+    }
+
+    // Prints the entries that got more than 10% slower; returns how many there were.
+    int compareWithBaseline(const juce::var& results, const juce::File& baselineFile){
+        const auto baseline = juce::JSON::parse(baselineFile);
+        std::map<juce::String, double> baselineCosts;
+        if (auto* entries = baseline["results"].getArray()){
+            for (auto& entry: *entries){
+                const auto cost = entry.hasProperty("nsPerSample") ? entry["nsPerSample"] : entry["nsPerCall"];
+                baselineCosts[entry["name"].toString()] = (double) cost;
+            }
+        }
+        int numRegressions = 0;
+        for (auto& entry: *results["results"].getArray()){
+            const auto found = baselineCosts.find(entry["name"].toString());
+            if (found == baselineCosts.end() || found->second <= 0.0){
+                continue;
+            }
+            const auto cost = (double) (entry.hasProperty("nsPerSample") ? entry["nsPerSample"] : entry["nsPerCall"]);
+            const auto ratio = cost / found->second;
+            if (ratio > 1.1){
+                std::cout << "slower  " << entry["name"].toString() << ": " << found->second << " -> " << cost << " ns ("
+                          << juce::roundToInt((ratio - 1.0) * 100.0) << "%)" << std::endl;
+                ++numRegressions;
+            }
+        }
+        return numRegressions;
+    }
+}
+
+int main (int argc, char* argv[])
+{
+    // The processor's parameters and timers expect a message manager, even without an editor.
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList args(argc, argv);
+    const auto outputFile = juce::File::getCurrentWorkingDirectory().getChildFile(args.containsOption("--output")
+                                                                                  ? args.getValueForOption("--output")
+                                                                                  : juce::String("benchmark.json"));
+    const auto requestedSamples = args.getValueForOption("--samples").getIntValue();
+    const auto numSamples = requestedSamples > 0 ? requestedSamples : 1 << 17;
+    const auto quick = args.containsOption("--quick");
+
+    juce::Array<int> blockSizes;
+    for (int blockSize = 1; blockSize <= 4096; blockSize *= 2){
+        if (!quick || blockSize == 64 || blockSize == 512){
+            blockSizes.add(blockSize);
+        }
+    }
+    const juce::Array<double> sampleRates = quick ? juce::Array<double>{48000.0} : juce::Array<double>{44100.0, 48000.0, 96000.0, 192000.0};
+    const juce::Array<Slope> slopes {Slope_12, Slope_24, Slope_36, Slope_48};
+    const juce::Array<int> channelCounts {1, 2};
+
+    juce::AudioBuffer<float> noise(channelCounts.getLast(), batchSize), batch(channelCounts.getLast(), batchSize);
+    juce::Random random(0x5EED);
+    for (int ch = 0; ch < noise.getNumChannels(); ++ch){
+        for (int i = 0; i < batchSize; ++i){
+            noise.setSample(ch, i, random.nextFloat() * 2.f - 1.f);
+        }
+    }
+
+    juce::Array<juce::var> entries;
+    for (auto sampleRate: sampleRates){
+        std::cout << "benchmarking at " << sampleRate << " Hz" << std::endl;
+        for (auto slope: slopes){
+            for (auto analogMatched: {false, true}){
+                entries.add(benchmarkDesign(slope, analogMatched, sampleRate));
+            }
+            for (int bypassMask = 0; bypassMask < 8; ++bypassMask){
+                // Both cuts share the slope, so with both bypassed it changes nothing: run those once.
+                if ((bypassMask & 5) == 5 && slope != slopes.getFirst()){
+                    continue;
+                }
+                for (auto numChannels: channelCounts){
+                    for (auto blockSize: blockSizes){
+                        Config config;
+                        config.slope = slope;
+                        config.bypassMask = bypassMask;
+                        config.sampleRate = sampleRate;
+                        config.numChannels = numChannels;
+                        config.blockSize = blockSize;
+                        for (auto analyzer: {false, true}){
+                            config.target = "processBlock";
+                            config.analyzer = analyzer;
+                            entries.add(benchmarkProcessBlock(config, numSamples, noise, batch));
+                        }
+                        config.analyzer = false;
+                        config.target = "cascade";
+                        entries.add(benchmarkCascade(config, numSamples, noise, batch));
+                        config.target = "monoChain";
+                        entries.add(benchmarkMonoChain(config, numSamples, noise, batch));
+                    }
+                }
+            }
+        }
+    }
+
+    auto* root = new juce::DynamicObject();
+    root->setProperty("date", juce::Time::getCurrentTime().toISO8601(true));
+    root->setProperty("cpu", juce::SystemStats::getCpuModel());
+    root->setProperty("cpuMHz", juce::SystemStats::getCpuSpeedInMegahertz());
+    root->setProperty("cycleCounter", hasCycleCounter ? "rdtsc" : "estimated from the nominal clock");
+    root->setProperty("samplesPerEntry", numSamples);
+    root->setProperty("results", entries);
+    const juce::var results(root);
+    if (!outputFile.replaceWithText(juce::JSON::toString(results))){
+        std::cerr << "could not write " << outputFile.getFullPathName() << std::endl;
+        return 1;
+    }
+    std::cout << "wrote " << entries.size() << " results to " << outputFile.getFullPathName() << std::endl;
+
+    if (args.containsOption("--baseline")){
+        const auto baselineFile = juce::File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--baseline"));
+        return compareWithBaseline(results, baselineFile) > 0 ? 1 : 0;
+    }
+    return 0;
+}
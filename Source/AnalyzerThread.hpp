@@ -0,0 +1,20 @@
+//
+//  AnalyzerThread.hpp
+//  Simple EQ
+//
+//  Copyright © 2022 Hsian. All rights reserved.
+//
+
+#ifndef AnalyzerThread_hpp
+#define AnalyzerThread_hpp
+#include "ClientThread.hpp"
+
+/*
+ Shared by every open editor. Runs the spectrum analysis (fifo draining, FFTs
+ and path building) so the message thread only has to draw the result; the
+ editors' frame timers wake it.
+ */
+struct AnalyzerThread : ClientThread {
+    AnalyzerThread() : ClientThread("Spectrum Analyzer", -1) {}
+};
+#endif /* AnalyzerThread_hpp */
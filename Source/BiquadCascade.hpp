@@ -0,0 +1,202 @@
+//
+//  BiquadCascade.hpp
+//  Simple EQ
+//
+//  Copyright © 2022 Hsian. All rights reserved.
+//
+
+#ifndef BiquadCascade_hpp
+#define BiquadCascade_hpp
+#include <JuceHeader.h>
+#include "ChainCoefficients.hpp"
+
+/*
+ Runs every active stage of a ChainCoefficients set over a block in a single
+ pass, transposed direct form II. SampleType is normally a SIMDRegister so
+ that each lane carries one channel.
+
+ The active stages are packed at the front of an aligned coefficient array
+ whenever the coefficients change; bypassed stages are dropped, and their
+ state is cleared so they start from silence when switched back on.
+
+ Packed, every slope and band-enable combination comes down to a stage count,
+ so there is one kernel per count (0 to 9) with a fixed trip count. The kernel
+ is picked once per coefficient change; nothing branches per sample.
+ */
+template<typename SampleType>
+struct BiquadCascade{
+    using NumericType = typename juce::dsp::SampleTypeHelpers::ElementType<SampleType>::Type;
+
+    void reset(){
+        s1.fill(SampleType::expand(NumericType(0)));
+        s2.fill(SampleType::expand(NumericType(0)));
+    }
+
+    void setCoefficients(const ChainCoefficients& chainCoefficients){
+        numActiveStages = 0;
+        for (int stage = 0; stage < NumChainStages; ++stage){
+            if (!chainCoefficients.active[stage]){
+                s1[stage] = SampleType::expand(NumericType(0));
+                s2[stage] = SampleType::expand(NumericType(0));
+                continue;
+            }
+            const auto& c = chainCoefficients.stages[stage];
+            auto& packed = packedStages[numActiveStages];
+            packed.b0 = SampleType::expand(static_cast<NumericType>(c[0]));
+            packed.b1 = SampleType::expand(static_cast<NumericType>(c[1]));
+            packed.b2 = SampleType::expand(static_cast<NumericType>(c[2]));
+            packed.a1 = SampleType::expand(static_cast<NumericType>(c[3]));
+            packed.a2 = SampleType::expand(static_cast<NumericType>(c[4]));
+            stageIndex[numActiveStages] = stage;
+            ++numActiveStages;
+        }
+        processFunction = getProcessFunction(numActiveStages, std::make_index_sequence<NumChainStages + 1>());
+    }
+
+    int getNumActiveStages() const {return numActiveStages;}
+
+    void process(SampleType* data, size_t numSamples){
+        if (numActiveStages == 0){
+            return;
+        }
+        // Gather the state of the packed stages so the kernel can keep it in registers for the whole block.
+        std::array<SampleType, NumChainStages> z1, z2;
+        for (int k = 0; k < numActiveStages; ++k){
+            z1[k] = s1[stageIndex[k]];
+            z2[k] = s2[stageIndex[k]];
+        }
+
+        processFunction(packedStages.data(), z1.data(), z2.data(), data, numSamples);
+
+        for (int k = 0; k < numActiveStages; ++k){
+            s1[stageIndex[k]] = z1[k];
+            s2[stageIndex[k]] = z2[k];
+        }
+    }
+private:
+    struct PackedStage{
+        SampleType b0, b1, b2, a1, a2;
+    };
+    using ProcessFunction = void (*)(const PackedStage*, SampleType*, SampleType*, SampleType*, size_t);
+
+    template<int NumStages>
+    static void processStages(const PackedStage* stages, SampleType* z1, SampleType* z2, SampleType* data, size_t numSamples){
+        if constexpr (NumStages > 0){
+            std::array<SampleType, NumStages> state1, state2;
+            for (int k = 0; k < NumStages; ++k){
+                state1[k] = z1[k];
+                state2[k] = z2[k];
+            }
+            for (size_t i = 0; i < numSamples; ++i){
+                auto x = data[i];
+                for (int k = 0; k < NumStages; ++k){
+                    const auto& c = stages[k];
+                    auto y = c.b0 * x + state1[k];
+                    state1[k] = c.b1 * x - c.a1 * y + state2[k];
+                    state2[k] = c.b2 * x - c.a2 * y;
+                    x = y;
+                }
+                data[i] = x;
+            }
+            for (int k = 0; k < NumStages; ++k){
+                z1[k] = state1[k];
+                z2[k] = state2[k];
+            }
+        }
+    }
+
+    template<size_t... StageCounts>
+    static ProcessFunction getProcessFunction(int numStages, std::index_sequence<StageCounts...>){
+        static constexpr ProcessFunction functions[] = {&processStages<(int) StageCounts>...};
+        return functions[numStages];
+    }
+
+    std::array<PackedStage, NumChainStages> packedStages;
+    std::array<int, NumChainStages> stageIndex {};
+    int numActiveStages = 0;
+    ProcessFunction processFunction = &processStages<0>;
+
+    // Indexed by chain stage, not by packed position, so a stage keeps its state while others come and go.
+    std::array<SampleType, NumChainStages> s1, s2;
+};
+
+/*
+ Runs a BiquadCascade over every channel of a buffer of float or double
+ samples. Channels are grouped SIMDRegister<SampleType>::size() at a time
+ (4 floats or 2 doubles with SSE/NEON, twice that in AVX builds) and each group
+ rides in the lanes of one register, so one cascade filters the whole group.
+ */
+template<typename SampleType>
+struct MultiChannelCascade{
+    using VectorType = juce::dsp::SIMDRegister<SampleType>;
+
+    void prepare(int numChannels, int maximumBlockSize){
+        constexpr auto numLanes = (int) VectorType::size();
+        const auto numGroups = juce::jmax(1, (numChannels + numLanes - 1) / numLanes);
+        cascades.clear();
+        for (int group = 0; group < numGroups; ++group){
+            cascades.add(new BiquadCascade<VectorType>())->reset();
+        }
+        interleavedBlock = juce::dsp::AudioBlock<VectorType>(interleavedData, (size_t) numGroups, (size_t) maximumBlockSize);
+        interleavedBlock.clear();
+    }
+
+    void reset(){
+        for (auto* cascade: cascades){
+            cascade->reset();
+        }
+    }
+
+    // Frees the SIMD buffers when the other precision is in use.
+    void release(){
+        cascades.clear();
+        interleavedBlock = {};
+        interleavedData.free();
+    }
+
+    void setCoefficients(const ChainCoefficients& chainCoefficients){
+        for (auto* cascade: cascades){
+            cascade->setCoefficients(chainCoefficients);
+        }
+    }
+
+    void process(juce::dsp::AudioBlock<SampleType>& block){
+        constexpr auto numLanes = VectorType::size();
+        if (interleavedBlock.getNumSamples() == 0){
+            // Not prepared, or released: there is no scratch to run through.
+            jassertfalse;
+            return;
+        }
+        const auto numChannels = juce::jmin(block.getNumChannels(), interleavedBlock.getNumChannels() * numLanes);
+
+        // Lanes past the last channel are cleared in prepare() and never written, so they stay silent.
+        for (size_t start = 0; start < block.getNumSamples(); start += interleavedBlock.getNumSamples()){
+            auto numSamples = juce::jmin(block.getNumSamples() - start, interleavedBlock.getNumSamples());
+
+            for (size_t ch = 0; ch < numChannels; ++ch){
+                auto* source = block.getChannelPointer(ch) + start;
+                auto* interleaved = reinterpret_cast<SampleType*>(interleavedBlock.getChannelPointer(ch / numLanes)) + ch % numLanes;
+                for (size_t i = 0; i < numSamples; ++i){
+                    interleaved[i * numLanes] = source[i];
+                }
+            }
+
+            for (int group = 0; group < cascades.size(); ++group){
+                cascades.getUnchecked(group)->process(interleavedBlock.getChannelPointer((size_t) group), numSamples);
+            }
+
+            for (size_t ch = 0; ch < numChannels; ++ch){
+                auto* destination = block.getChannelPointer(ch) + start;
+                auto* interleaved = reinterpret_cast<const SampleType*>(interleavedBlock.getChannelPointer(ch / numLanes)) + ch % numLanes;
+                for (size_t i = 0; i < numSamples; ++i){
+                    destination[i] = interleaved[i * numLanes];
+                }
+            }
+        }
+    }
+private:
+    juce::OwnedArray<BiquadCascade<VectorType>> cascades;
+    juce::HeapBlock<char> interleavedData;
+    juce::dsp::AudioBlock<VectorType> interleavedBlock;
+};
+#endif /* BiquadCascade_hpp */
@@ -0,0 +1,120 @@
+//
+//  CascadeResponse.cpp
+//  Simple EQ
+//
+//  Copyright © 2022 Hsian. All rights reserved.
+//
+
+#include "CascadeResponse.hpp"
+
+namespace {
+    // c0 + c1 z + c2 z^2 at z = e^-jw.
+    struct Polynomial{
+        double re, im;
+    };
+
+    inline Polynomial evaluatePolynomial(double c0, double c1, double c2,
+                                         double cos1, double sin1, double cos2, double sin2){
+        return {c0 + c1 * cos1 + c2 * cos2, -(c1 * sin1 + c2 * sin2)};
+    }
+
+    // That polynomial's contribution to the group delay, Re(z A'(z) / A(z)) = Re((c1 z + 2 c2 z^2) / A(z)).
+    inline double polynomialDelay(const Polynomial& value, double c1, double c2,
+                                  double cos1, double sin1, double cos2, double sin2){
+        const auto derivativeRe = c1 * cos1 + 2.0 * c2 * cos2;
+        const auto derivativeIm = -(c1 * sin1 + 2.0 * c2 * sin2);
+        return (derivativeRe * value.re + derivativeIm * value.im) / (value.re * value.re + value.im * value.im);
+    }
+}
+
+void CascadeResponse::prepare(const std::vector<double>& frequencies, double newSampleRate){
+    sampleRate = newSampleRate;
+    const auto numFrequencies = frequencies.size();
+    for (auto* table: {&cos1, &sin1, &cos2, &sin2}){
+        table->resize(numFrequencies);
+    }
+    for (size_t i = 0; i < numFrequencies; ++i){
+        const auto w = juce::MathConstants<double>::twoPi * frequencies[i] / sampleRate;
+        cos1[i] = std::cos(w);
+        sin1[i] = std::sin(w);
+        cos2[i] = std::cos(2.0 * w);
+        sin2[i] = std::sin(2.0 * w);
+    }
+}
+
+void CascadeResponse::process(const ChainCoefficients& chainCoefficients,
+                              double* magnitudeDb,
+                              double* phaseRadians,
+                              double* groupDelaySeconds){
+    if (groupDelaySeconds != nullptr){
+        process<true>(chainCoefficients, magnitudeDb, phaseRadians, groupDelaySeconds);
+    } else {
+        process<false>(chainCoefficients, magnitudeDb, phaseRadians, nullptr);
+    }
+}
+
+template<bool withGroupDelay>
+void CascadeResponse::process(const ChainCoefficients& chainCoefficients,
+                              double* magnitudeDb,
+                              double* phaseRadians,
+                              double* groupDelaySeconds){
+    const auto numFrequencies = getNumFrequencies();
+    // Blocks of frequencies whose running products live on the stack: they can't alias
+    // the tables, so the inner loop vectorises without any run-time alias checks.
+    constexpr int blockSize = 64;
+    for (int start = 0; start < numFrequencies; start += blockSize){
+        const auto numInBlock = juce::jmin(blockSize, numFrequencies - start);
+        const auto* c1 = cos1.data() + start;
+        const auto* s1 = sin1.data() + start;
+        const auto* c2 = cos2.data() + start;
+        const auto* s2 = sin2.data() + start;
+        double nRe[blockSize], nIm[blockSize], dRe[blockSize], dIm[blockSize], tau[blockSize];
+        std::fill_n(nRe, numInBlock, 1.0);
+        std::fill_n(nIm, numInBlock, 0.0);
+        std::fill_n(dRe, numInBlock, 1.0);
+        std::fill_n(dIm, numInBlock, 0.0);
+        if constexpr (withGroupDelay){
+            std::fill_n(tau, numInBlock, 0.0);
+        }
+        
+        for (int stage = 0; stage < NumChainStages; ++stage){
+            if (!chainCoefficients.active[stage]){
+                continue;
+            }
+            const auto& coefficients = chainCoefficients.stages[stage];
+            const auto b0 = coefficients[0], b1 = coefficients[1], b2 = coefficients[2];
+            const auto a1 = coefficients[3], a2 = coefficients[4];
+            for (int i = 0; i < numInBlock; ++i){
+                const auto n = evaluatePolynomial(b0, b1, b2, c1[i], s1[i], c2[i], s2[i]);
+                const auto d = evaluatePolynomial(1.0, a1, a2, c1[i], s1[i], c2[i], s2[i]);
+                
+                const auto nr = nRe[i] * n.re - nIm[i] * n.im;
+                nIm[i] = nRe[i] * n.im + nIm[i] * n.re;
+                nRe[i] = nr;
+                const auto dr = dRe[i] * d.re - dIm[i] * d.im;
+                dIm[i] = dRe[i] * d.im + dIm[i] * d.re;
+                dRe[i] = dr;
+                if constexpr (withGroupDelay){
+                    tau[i] += polynomialDelay(n, b1, b2, c1[i], s1[i], c2[i], s2[i])
+                            - polynomialDelay(d, a1, a2, c1[i], s1[i], c2[i], s2[i]);
+                }
+            }
+        }
+        
+        for (int i = 0; i < numInBlock; ++i){
+            const auto numeratorPower = nRe[i] * nRe[i] + nIm[i] * nIm[i];
+            const auto denominatorPower = dRe[i] * dRe[i] + dIm[i] * dIm[i];
+            magnitudeDb[start + i] = juce::Decibels::gainToDecibels(std::sqrt(numeratorPower / denominatorPower));
+        }
+        if (phaseRadians != nullptr){
+            for (int i = 0; i < numInBlock; ++i){
+                phaseRadians[start + i] = std::arg(std::complex<double>(nRe[i], nIm[i]) / std::complex<double>(dRe[i], dIm[i]));
+            }
+        }
+        if constexpr (withGroupDelay){
+            for (int i = 0; i < numInBlock; ++i){
+                groupDelaySeconds[start + i] = tau[i] / sampleRate;
+            }
+        }
+    }
+}
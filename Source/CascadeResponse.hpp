@@ -0,0 +1,44 @@
+//
+//  CascadeResponse.hpp
+//  Simple EQ
+//
+//  Copyright © 2022 Hsian. All rights reserved.
+//
+
+#ifndef CascadeResponse_hpp
+#define CascadeResponse_hpp
+#include <JuceHeader.h>
+#include "ChainCoefficients.hpp"
+
+/*
+ Frequency response of a whole chain over a fixed frequency grid.
+
+ The e^-jw and e^-2jw terms of every grid point are tabulated once in
+ prepare(); after that, evaluating the chain is a few multiply-adds per
+ stage and frequency, run stage by stage over plain arrays so the compiler
+ vectorises the frequency loop. Only the final dB, phase and group delay
+ conversions call into libm, once per frequency rather than once per stage.
+ The group delay terms, with their two divisions per stage, are only
+ compiled into the loop when a group delay output is passed.
+ */
+struct CascadeResponse{
+    void prepare(const std::vector<double>& frequencies, double sampleRate);
+    int getNumFrequencies() const {return (int) cos1.size();}
+
+    // Each output must hold getNumFrequencies() values. Phase is wrapped to
+    // [-pi, pi]; group delay is in seconds. Pass nullptr to skip either.
+    void process(const ChainCoefficients& chainCoefficients,
+                 double* magnitudeDb,
+                 double* phaseRadians = nullptr,
+                 double* groupDelaySeconds = nullptr);
+private:
+    template<bool withGroupDelay>
+    void process(const ChainCoefficients& chainCoefficients,
+                 double* magnitudeDb,
+                 double* phaseRadians,
+                 double* groupDelaySeconds);
+
+    double sampleRate = 0.0;
+    std::vector<double> cos1, sin1, cos2, sin2;
+};
+#endif /* CascadeResponse_hpp */
@@ -0,0 +1,26 @@
+//
+//  ChainCoefficients.hpp
+//  Simple EQ
+//
+//  Copyright © 2022 Hsian. All rights reserved.
+//
+
+#ifndef ChainCoefficients_hpp
+#define ChainCoefficients_hpp
+#include <JuceHeader.h>
+
+// Every biquad of a MonoChain, flattened: the four low cut sections, the peak, then the four high cut sections.
+constexpr int NumCutStages = 4;
+constexpr int PeakStage = NumCutStages;
+constexpr int LowCutFirstStage = 0;
+constexpr int HighCutFirstStage = PeakStage + 1;
+constexpr int NumChainStages = 2 * NumCutStages + 1;
+
+// Designed in double; each engine narrows to its own sample type when it loads them.
+struct ChainCoefficients {
+    using StageCoefficients = std::array<double, 5>; // b0, b1, b2, a1, a2, normalised by a0
+    std::array<StageCoefficients, NumChainStages> stages;
+    std::array<bool, NumChainStages> active;
+    bool linearPhase = false;
+};
+#endif /* ChainCoefficients_hpp */
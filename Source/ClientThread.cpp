@@ -0,0 +1,43 @@
+//
+//  ClientThread.cpp
+//  Simple EQ
+//
+//  Copyright © 2022 Hsian. All rights reserved.
+//
+
+#include "ClientThread.hpp"
+
+ClientThread::ClientThread(const juce::String& threadName, int pollInterval)
+    : juce::Thread(threadName), pollIntervalMs(pollInterval) {}
+
+ClientThread::~ClientThread(){
+    stopThread(1000);
+}
+
+void ClientThread::addClient(Client* client){
+    const juce::ScopedLock sl(clientLock);
+    clients.addIfNotAlreadyThere(client);
+    // Started here rather than in the constructor, where run() could be
+    // called before the subclass is fully constructed.
+    if (!isThreadRunning()){
+        startThread();
+    }
+}
+
+void ClientThread::removeClient(Client* client){
+    // Once this returns the thread is guaranteed not to be inside the client.
+    const juce::ScopedLock sl(clientLock);
+    clients.removeFirstMatchingValue(client);
+}
+
+void ClientThread::run(){
+    while (!threadShouldExit()){
+        {
+            const juce::ScopedLock sl(clientLock);
+            for (auto* client: clients){
+                client->threadCallback();
+            }
+        }
+        wait(pollIntervalMs);
+    }
+}
@@ -0,0 +1,36 @@
+//
+//  ClientThread.hpp
+//  Simple EQ
+//
+//  Copyright © 2022 Hsian. All rights reserved.
+//
+
+#ifndef ClientThread_hpp
+#define ClientThread_hpp
+#include <JuceHeader.h>
+
+/*
+ A background thread with a list of clients. It sleeps until someone calls
+ notify() or pollIntervalMs runs out (-1: only notify() wakes it), then gives
+ every client one threadCallback() and goes back to sleep. Subclass it once
+ per job and share the subclass through a juce::SharedResourcePointer.
+ */
+struct ClientThread : juce::Thread {
+    struct Client {
+        virtual ~Client() = default;
+        virtual void threadCallback() = 0;
+    };
+
+    ClientThread(const juce::String& threadName, int pollIntervalMs);
+    ~ClientThread() override;
+
+    void addClient(Client* client);
+    void removeClient(Client* client);
+
+    void run() override;
+private:
+    const int pollIntervalMs;
+    juce::CriticalSection clientLock;
+    juce::Array<Client*> clients;
+};
+#endif /* ClientThread_hpp */
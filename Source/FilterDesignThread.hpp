@@ -0,0 +1,20 @@
+//
+//  FilterDesignThread.hpp
+//  Simple EQ
+//
+//  Copyright © 2022 Hsian. All rights reserved.
+//
+
+#ifndef FilterDesignThread_hpp
+#define FilterDesignThread_hpp
+#include "ClientThread.hpp"
+
+/*
+ Shared by every plugin instance. Each processor redesigns its filter
+ coefficients in threadCallback() if a parameter has moved. Parameters move on
+ the audio thread too, which mustn't signal anything, so the thread polls.
+ */
+struct FilterDesignThread : ClientThread {
+    FilterDesignThread() : ClientThread("Filter Design", 2) {}
+};
+#endif /* FilterDesignThread_hpp */
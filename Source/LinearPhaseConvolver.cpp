@@ -0,0 +1,195 @@
+//
+//  LinearPhaseConvolver.cpp
+//  Simple EQ
+//
+//  Copyright © 2022 Hsian. All rights reserved.
+//
+
+#include "LinearPhaseConvolver.hpp"
+
+namespace {
+    double getStageMagnitude(const ChainCoefficients::StageCoefficients& c, double w){
+        const auto z1 = std::polar(1.0, -w);
+        const auto z2 = z1 * z1;
+        const auto numerator = c[0] + c[1] * z1 + c[2] * z2;
+        const auto denominator = 1.0 + c[3] * z1 + c[4] * z2;
+        return std::abs(numerator) / std::abs(denominator);
+    }
+
+    // Complex multiply-accumulate over (re, im) pairs.
+    void multiplyAdd(const float* a, const float* b, float* result, int numBins){
+        for (int i = 0; i < numBins; ++i){
+            const auto re = a[2 * i] * b[2 * i] - a[2 * i + 1] * b[2 * i + 1];
+            const auto im = a[2 * i] * b[2 * i + 1] + a[2 * i + 1] * b[2 * i];
+            result[2 * i] += re;
+            result[2 * i + 1] += im;
+        }
+    }
+}
+
+int LinearPhaseConvolver::getFIROrderForSampleRate(double sampleRate){
+    return juce::jlimit(13, 15, (int) std::ceil(std::log2(sampleRate * 0.17)));
+}
+
+void LinearPhaseConvolver::designKernel(const ChainCoefficients& chainCoefficients, int firOrder, LinearPhaseKernel& kernel){
+    const auto firLength = 1 << firOrder;
+    const auto numPartitions = firLength / partitionSize;
+
+    // Zero-phase spectrum of the chain's magnitude response...
+    std::vector<float> fir((size_t) (2 * firLength), 0.f);
+    for (int bin = 0; bin <= firLength / 2; ++bin){
+        const auto w = juce::MathConstants<double>::twoPi * bin / firLength;
+        double magnitude = 1.0;
+        for (int stage = 0; stage < NumChainStages; ++stage){
+            if (chainCoefficients.active[stage]){
+                magnitude *= getStageMagnitude(chainCoefficients.stages[stage], w);
+            }
+        }
+        fir[(size_t) (2 * bin)] = (float) magnitude;
+    }
+    juce::dsp::FFT firFFT(firOrder);
+    firFFT.performRealOnlyInverseTransform(fir.data());
+
+    // ...turned into a causal FIR centred on firLength / 2. The window is
+    // symmetric about the centre tap, so the phase stays exactly linear.
+    std::rotate(fir.begin(), fir.begin() + firLength / 2, fir.begin() + firLength);
+    std::vector<float> window((size_t) firLength + 1);
+    juce::dsp::WindowingFunction<float>::fillWindowingTables(window.data(), window.size(),
+                                                             juce::dsp::WindowingFunction<float>::hann, false);
+    juce::FloatVectorOperations::multiply(fir.data(), window.data(), firLength);
+
+    kernel.firOrder = firOrder;
+    kernel.isIdentity = std::none_of(chainCoefficients.active.begin(), chainCoefficients.active.end(),
+                                     [](bool active){return active;});
+    kernel.partitionSpectra.resize((size_t) (numPartitions * spectrumSize));
+    juce::dsp::FFT partitionFFT(partitionOrder + 1);
+    std::vector<float> buffer((size_t) (2 * fftSize));
+    for (int partition = 0; partition < numPartitions; ++partition){
+        std::fill(buffer.begin(), buffer.end(), 0.f);
+        std::copy(fir.begin() + partition * partitionSize, fir.begin() + (partition + 1) * partitionSize, buffer.begin());
+        partitionFFT.performRealOnlyForwardTransform(buffer.data(), true);
+        std::copy(buffer.begin(), buffer.begin() + spectrumSize, kernel.partitionSpectra.begin() + partition * spectrumSize);
+    }
+}
+
+void LinearPhaseConvolver::prepare(int firOrder, int numChannels){
+    firLength = 1 << firOrder;
+    numPartitions = firLength / partitionSize;
+
+    channels.resize((size_t) numChannels);
+    for (auto& channel: channels){
+        channel.frame.assign((size_t) fftSize, 0.f);
+        channel.output.assign((size_t) partitionSize, 0.f);
+        channel.delayLine.assign((size_t) (numPartitions * spectrumSize), 0.f);
+        channel.history.assign((size_t) firLength, 0.f);
+    }
+    fftBuffer.assign((size_t) (2 * fftSize), 0.f);
+    fadeBuffer.assign((size_t) (2 * fftSize), 0.f);
+    kernelSpectra.assign((size_t) (numPartitions * spectrumSize), 0.f);
+    incomingSpectra.assign((size_t) (numPartitions * spectrumSize), 0.f);
+    hasKernel = false;
+    fadePending = false;
+    kernelIsIdentity = false;
+    incomingIsIdentity = false;
+    reset();
+}
+
+void LinearPhaseConvolver::reset(){
+    for (auto& channel: channels){
+        std::fill(channel.frame.begin(), channel.frame.end(), 0.f);
+        std::fill(channel.output.begin(), channel.output.end(), 0.f);
+        std::fill(channel.delayLine.begin(), channel.delayLine.end(), 0.f);
+        std::fill(channel.history.begin(), channel.history.end(), 0.f);
+    }
+    position = 0;
+    delayLineIndex = 0;
+    historyIndex = 0;
+}
+
+void LinearPhaseConvolver::setKernel(const LinearPhaseKernel& kernel){
+    if (kernel.partitionSpectra.size() != kernelSpectra.size()){
+        // Designed for a sample rate we're no longer prepared for.
+        return;
+    }
+    auto& destination = hasKernel ? incomingSpectra : kernelSpectra;
+    std::copy(kernel.partitionSpectra.begin(), kernel.partitionSpectra.end(), destination.begin());
+    (hasKernel ? incomingIsIdentity : kernelIsIdentity) = kernel.isIdentity;
+    fadePending = hasKernel;
+    hasKernel = true;
+}
+
+void LinearPhaseConvolver::process(juce::dsp::AudioBlock<float>& block){
+    const auto numChannels = juce::jmin(block.getNumChannels(), channels.size());
+    const auto numSamples = block.getNumSamples();
+    size_t done = 0;
+    while (done < numSamples){
+        const auto numToCopy = juce::jmin(numSamples - done, (size_t) (partitionSize - position));
+        for (size_t ch = 0; ch < numChannels; ++ch){
+            auto& channel = channels[ch];
+            auto* data = block.getChannelPointer(ch) + done;
+            juce::FloatVectorOperations::copy(channel.frame.data() + partitionSize + position, data, (int) numToCopy);
+            juce::FloatVectorOperations::copy(data, channel.output.data() + position, (int) numToCopy);
+        }
+        position += (int) numToCopy;
+        done += numToCopy;
+        if (position == partitionSize){
+            processPartition();
+            position = 0;
+        }
+    }
+}
+
+void LinearPhaseConvolver::processPartition(){
+    delayLineIndex = (delayLineIndex + 1) % numPartitions;
+    for (auto& channel: channels){
+        std::fill(fftBuffer.begin(), fftBuffer.end(), 0.f);
+        std::copy(channel.frame.begin(), channel.frame.end(), fftBuffer.begin());
+        fft.performRealOnlyForwardTransform(fftBuffer.data(), true);
+        std::copy(fftBuffer.begin(), fftBuffer.begin() + spectrumSize, channel.delayLine.begin() + delayLineIndex * spectrumSize);
+        std::copy(channel.frame.begin() + partitionSize, channel.frame.end(), channel.history.begin() + historyIndex);
+        std::copy(channel.frame.begin() + partitionSize, channel.frame.end(), channel.frame.begin());
+
+        // Overlap-save: only the second half of the circular result is free of wrap-around.
+        render(channel, kernelSpectra, kernelIsIdentity, fftBuffer.data());
+        if (fadePending){
+            render(channel, incomingSpectra, incomingIsIdentity, fadeBuffer.data());
+            for (int i = 0; i < partitionSize; ++i){
+                const auto gain = (float) i / (float) partitionSize;
+                const auto previous = fftBuffer[(size_t) (partitionSize + i)];
+                channel.output[(size_t) i] = previous + (fadeBuffer[(size_t) (partitionSize + i)] - previous) * gain;
+            }
+        } else {
+            std::copy(fftBuffer.begin() + partitionSize, fftBuffer.begin() + fftSize, channel.output.begin());
+        }
+    }
+    historyIndex = (historyIndex + partitionSize) % firLength;
+    if (fadePending){
+        std::swap(kernelSpectra, incomingSpectra);
+        kernelIsIdentity = incomingIsIdentity;
+        fadePending = false;
+    }
+}
+
+void LinearPhaseConvolver::render(const ChannelState& channel, const std::vector<float>& spectra, bool isIdentity, float* result){
+    if (!isIdentity){
+        convolve(channel, spectra, result);
+        return;
+    }
+    // The identity FIR is a single tap at firLength / 2: read the newest partition
+    // back from that far in the past. The spectra above are still kept up to date
+    // so a crossfade to a real kernel has its full history.
+    const auto readIndex = (historyIndex - firLength / 2 + firLength) % firLength;
+    std::copy(channel.history.begin() + readIndex, channel.history.begin() + readIndex + partitionSize, result + partitionSize);
+}
+
+void LinearPhaseConvolver::convolve(const ChannelState& channel, const std::vector<float>& spectra, float* result){
+    std::fill(result, result + 2 * fftSize, 0.f);
+    for (int partition = 0; partition < numPartitions; ++partition){
+        const auto slot = (delayLineIndex - partition + numPartitions) % numPartitions;
+        multiplyAdd(channel.delayLine.data() + slot * spectrumSize,
+                    spectra.data() + partition * spectrumSize,
+                    result,
+                    spectrumSize / 2);
+    }
+    fft.performRealOnlyInverseTransform(result);
+}
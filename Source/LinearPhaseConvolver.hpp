@@ -0,0 +1,72 @@
+//
+//  LinearPhaseConvolver.hpp
+//  Simple EQ
+//
+//  Copyright © 2022 Hsian. All rights reserved.
+//
+
+#ifndef LinearPhaseConvolver_hpp
+#define LinearPhaseConvolver_hpp
+#include <JuceHeader.h>
+#include "ChainCoefficients.hpp"
+
+// The FIR of the current curve, already split into partitions and transformed.
+struct LinearPhaseKernel{
+    int firOrder = 0;
+    // No stage is active: the FIR is a pure delay of half its length.
+    bool isIdentity = false;
+    // One spectrum per partition, (re, im) for bins 0 to fftSize / 2.
+    std::vector<float> partitionSpectra;
+};
+
+/*
+ Linear-phase version of the chain: a symmetric FIR with the magnitude
+ response of the biquads, run through a uniformly partitioned overlap-save
+ FFT convolver.
+
+ Kernels are designed off the audio thread with designKernel(). setKernel()
+ only copies into preallocated storage; the new kernel is crossfaded in over
+ the next partition. Nothing in process() allocates.
+
+ A flat curve's kernel is a pure delay, so it skips the convolution and reads
+ the input back from a history line instead, with the same latency.
+ */
+struct LinearPhaseConvolver{
+    static constexpr int partitionOrder = 8;
+    static constexpr int partitionSize = 1 << partitionOrder;
+    static constexpr int fftSize = 2 * partitionSize;
+    static constexpr int spectrumSize = fftSize + 2;
+
+    // Long enough to resolve a 20 Hz low cut: about 170 ms of taps.
+    static int getFIROrderForSampleRate(double sampleRate);
+    static void designKernel(const ChainCoefficients& chainCoefficients, int firOrder, LinearPhaseKernel& kernel);
+
+    void prepare(int firOrder, int numChannels);
+    void reset();
+    int getLatencySamples() const {return partitionSize + firLength / 2;}
+
+    void setKernel(const LinearPhaseKernel& kernel);
+    void process(juce::dsp::AudioBlock<float>& block);
+private:
+    struct ChannelState{
+        std::vector<float> frame;     // the last fftSize input samples, the newest partition last
+        std::vector<float> output;    // the partition being played out
+        std::vector<float> delayLine; // input spectra of the last numPartitions frames
+        std::vector<float> history;   // the last firLength input samples, for identity kernels
+    };
+    std::vector<ChannelState> channels;
+
+    int firLength = 0, numPartitions = 0;
+    int position = 0, delayLineIndex = 0, historyIndex = 0;
+
+    juce::dsp::FFT fft {partitionOrder + 1};
+    std::vector<float> fftBuffer, fadeBuffer;
+    std::vector<float> kernelSpectra, incomingSpectra;
+    bool hasKernel = false, fadePending = false;
+    bool kernelIsIdentity = false, incomingIsIdentity = false;
+
+    void processPartition();
+    void render(const ChannelState& channel, const std::vector<float>& spectra, bool isIdentity, float* result);
+    void convolve(const ChannelState& channel, const std::vector<float>& spectra, float* result);
+};
+#endif /* LinearPhaseConvolver_hpp */
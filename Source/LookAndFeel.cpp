@@ -11,69 +11,95 @@
 void LookAndFeel::drawRotarySlider(juce::Graphics &g, int x, int y, int width, int height, float sliderPosProportional, float rotaryStartAngle, float rotaryEndAngle, juce::Slider & slider){
     using namespace juce;
     auto bounds  = Rectangle<float>(x, y, width, height);
-    auto enabled = slider.isEnabled();
+    drawRotarySliderBody(g, bounds, slider.isEnabled());
+    if (auto* rswl = dynamic_cast<RotarySliderWithLabels*>(&slider)){
+        drawRotarySliderPointer(g, *rswl, bounds, sliderPosProportional, rotaryStartAngle, rotaryEndAngle);
+    }
+}
+
+void LookAndFeel::drawRotarySliderBody(juce::Graphics& g, juce::Rectangle<float> bounds, bool enabled){
+    using namespace juce;
     g.setColour(enabled ? Colour(97u, 18u, 167u): Colours::darkgrey);
     g.fillEllipse(bounds);
     
     g.setColour(enabled ? Colour(255u, 154u, 1u) : Colours::grey);
     g.drawEllipse(bounds, 1.f);
-    if (auto* rswl = dynamic_cast<RotarySliderWithLabels*>(&slider)){
-        auto center = bounds.getCentre();
-        Path p;
+}
+
+void LookAndFeel::drawRotarySliderPointer(juce::Graphics& g, RotarySliderWithLabels& slider, juce::Rectangle<float> bounds, float sliderPosProportional, float rotaryStartAngle, float rotaryEndAngle){
+    using namespace juce;
+    auto& cache = slider.overlay;
+    auto center = bounds.getCentre();
+    const auto enabled = slider.isEnabled();
+    const auto textHeight = (float) slider.getTextHeight();
+    if (bounds != cache.bounds){
+        cache.bounds = bounds;
+        cache.value = std::numeric_limits<double>::quiet_NaN();
         
         Rectangle<float> r;
         r.setLeft(center.getX() -2);
         r.setRight(center.getX() + 2);
         r.setTop(bounds.getY());
-        r.setBottom(center.getY() - rswl->getTextHeight() * 1.5);
-        p.addRoundedRectangle(r, 2.f);
-        jassert(rotaryStartAngle < rotaryEndAngle);
-        auto sliderAngRad = jmap(sliderPosProportional, 0.f, 1.f, rotaryStartAngle, rotaryEndAngle);
-        
-        p.applyTransform(AffineTransform().rotated(sliderAngRad, center.getX(), center.getY()));
-        g.fillPath(p);
-        
-        g.setFont(rswl->getTextHeight());
-        auto text = rswl->getDisplayString();
-        auto strWidth = g.getCurrentFont().getStringWidth(text);
-        r.setSize(strWidth + 4, rswl->getTextHeight() + 2);
-        r.setCentre(bounds.getCentre());
-        g.setColour(enabled ? Colours::black : Colours::darkgrey);
-        g.fillRect(r);
-        
-        g.setColour(enabled ? Colours::white : Colours::lightgrey);
-        g.drawFittedText(text, r.toNearestInt(), juce::Justification::centred, 1);
-        
+        r.setBottom(center.getY() - textHeight * 1.5);
+        cache.pointer.clear();
+        cache.pointer.addRoundedRectangle(r, 2.f);
+    }
+    jassert(rotaryStartAngle < rotaryEndAngle);
+    auto sliderAngRad = jmap(sliderPosProportional, 0.f, 1.f, rotaryStartAngle, rotaryEndAngle);
+    g.setColour(enabled ? Colour(255u, 154u, 1u) : Colours::grey);
+    g.fillPath(cache.pointer, AffineTransform::rotation(sliderAngRad, center.getX(), center.getY()));
+    
+    if (slider.getValue() != cache.value || enabled != cache.enabled){
+        cache.value = slider.getValue();
+        cache.enabled = enabled;
+        Font font(textHeight);
+        auto text = slider.getDisplayString();
+        cache.textBox.setSize(font.getStringWidthFloat(text) + 4, textHeight + 2);
+        cache.textBox.setCentre(center);
+        auto textArea = cache.textBox.toNearestInt().toFloat();
+        cache.text.clear();
+        cache.text.addFittedText(font, text, textArea.getX(), textArea.getY(), textArea.getWidth(), textArea.getHeight(),
+                                 Justification::centred, 1);
     }
-   
+    g.setColour(enabled ? Colours::black : Colours::darkgrey);
+    g.fillRect(cache.textBox);
+    
+    g.setColour(enabled ? Colours::white : Colours::lightgrey);
+    cache.text.draw(g);
 }
+
 void LookAndFeel::drawToggleButton (juce::Graphics& g, juce::ToggleButton& toggleButton, bool shouldDrawButtonAsHighlighted, bool shouldDrawButtonAsDown){
     using namespace juce;
+    // Both buttons only have two looks, so each draws from a sprite keyed by its toggle state.
+    auto bounds = toggleButton.getLocalBounds();
+    auto toggled = toggleButton.getToggleState();
     if (auto* pb = dynamic_cast<PowerButton*>(&toggleButton)){
-        Path powerButton;
-        auto bounds = toggleButton.getLocalBounds();
-        auto size = juce::jmin(bounds.getWidth(), bounds.getHeight()) - 6;
-        auto r = bounds.withSizeKeepingCentre(size, size).toFloat();
-        float ang = 30.f;
-        size -= 6;
-        powerButton.addCentredArc(r.getCentreX(), r.getCentreY(), size * 0.5, size *0.5, 0.f, degreesToRadians(ang), degreesToRadians(360 - ang), true);
-        powerButton.startNewSubPath(r.getCentreX(), r.getY());
-        powerButton.lineTo(r.getCentre());
-        
-        
-        PathStrokeType pst(2, PathStrokeType::JointStyle::curved);
-        auto color = toggleButton.getToggleState() ? Colours::dimgrey : Colour(0u, 172u, 1u);
-        g.setColour(color);
-        g.strokePath(powerButton, pst);
-        g.drawEllipse(r, 2);
+        pb->sprite.draw(g, bounds, toggled ? 1 : 0, [bounds, toggled](Graphics& sg){
+            Path powerButton;
+            auto size = juce::jmin(bounds.getWidth(), bounds.getHeight()) - 6;
+            auto r = bounds.withSizeKeepingCentre(size, size).toFloat();
+            float ang = 30.f;
+            size -= 6;
+            powerButton.addCentredArc(r.getCentreX(), r.getCentreY(), size * 0.5, size *0.5, 0.f, degreesToRadians(ang), degreesToRadians(360 - ang), true);
+            powerButton.startNewSubPath(r.getCentreX(), r.getY());
+            powerButton.lineTo(r.getCentre());
+            
+            
+            PathStrokeType pst(2, PathStrokeType::JointStyle::curved);
+            auto color = toggled ? Colours::dimgrey : Colour(0u, 172u, 1u);
+            sg.setColour(color);
+            sg.strokePath(powerButton, pst);
+            sg.drawEllipse(r, 2);
+        });
     }
     else if (auto* ab = dynamic_cast<AnalyzerButton*>(&toggleButton)){
-        auto color = toggleButton.getToggleState() ?  Colour(0u, 172u, 1u): Colours::dimgrey ;
-        g.setColour(color);
-        auto bounds = toggleButton.getLocalBounds();
-        g.drawRect(bounds);
-        
-        g.strokePath(ab->randomPath, PathStrokeType(1.f));
+        ab->sprite.draw(g, bounds, toggled ? 1 : 0, [ab, bounds, toggled](Graphics& sg){
+            auto color = toggled ?  Colour(0u, 172u, 1u): Colours::dimgrey ;
+            sg.setColour(color);
+            sg.drawRect(bounds);
+            
+            sg.strokePath(ab->randomPath, PathStrokeType(1.f));
+        });
     }
 
     
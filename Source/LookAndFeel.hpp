@@ -9,12 +9,55 @@
 #ifndef LookAndFeel_hpp
 #define LookAndFeel_hpp
 
+struct RotarySliderWithLabels;
+
+// A pre-rendered image of the static part of a control. It is re-rendered only
+// when the area, the display scale or the caller's state key changes.
+struct SpriteCache {
+    template<typename RenderFunction>
+    void draw(juce::Graphics& g, juce::Rectangle<int> area, int state, RenderFunction&& render){
+        const auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+        if (image.isNull() || area != cachedArea || scale != cachedScale || state != cachedState){
+            cachedArea = area;
+            cachedScale = scale;
+            cachedState = state;
+            image = juce::Image(juce::Image::PixelFormat::ARGB,
+                                juce::jmax(1, juce::roundToInt(area.getWidth() * scale)),
+                                juce::jmax(1, juce::roundToInt(area.getHeight() * scale)),
+                                true);
+            juce::Graphics spriteGraphics(image);
+            spriteGraphics.addTransform(juce::AffineTransform::translation((float) -area.getX(), (float) -area.getY())
+                                        .scaled(scale));
+            render(spriteGraphics);
+        }
+        g.drawImage(image, area.toFloat());
+    }
+    void invalidate() {image = {};}
+private:
+    juce::Image image;
+    juce::Rectangle<int> cachedArea;
+    float cachedScale = 0.f;
+    int cachedState = -1;
+};
+
+// What a knob draws on top of its sprite every frame: the pointer, and the value
+// text, laid out again only when the displayed value changes.
+struct KnobOverlayCache {
+    juce::Rectangle<float> bounds;
+    juce::Path pointer;
+    double value = std::numeric_limits<double>::quiet_NaN();
+    bool enabled = true;
+    juce::GlyphArrangement text;
+    juce::Rectangle<float> textBox;
+};
+
 struct PowerButton : juce::ToggleButton {
-    
+    SpriteCache sprite;
 };
 
 struct AnalyzerButton : juce::ToggleButton {
     void resized() override{
+        sprite.invalidate();
         auto bounds = getLocalBounds();
         auto insetRect = bounds.reduced(4);
         randomPath.clear();
@@ -25,6 +68,7 @@ struct AnalyzerButton : juce::ToggleButton {
         }
     };
     juce::Path randomPath;
+    SpriteCache sprite;
 };
 
 struct LookAndFeel: juce::LookAndFeel_V4{
@@ -35,6 +79,11 @@ struct LookAndFeel: juce::LookAndFeel_V4{
                                    float rotaryStartAngle,
                                    float rotaryEndAngle,
                            juce::Slider&) override;
+    // The two layers of drawRotarySlider(): RotarySliderWithLabels caches the body
+    // in a sprite and only draws the pointer and value text per frame.
+    void drawRotarySliderBody(juce::Graphics& g, juce::Rectangle<float> bounds, bool enabled);
+    void drawRotarySliderPointer(juce::Graphics& g, RotarySliderWithLabels& slider, juce::Rectangle<float> bounds,
+                                 float sliderPosProportional, float rotaryStartAngle, float rotaryEndAngle);
     void drawToggleButton (juce::Graphics& g, juce::ToggleButton& toggleButton, bool shouldDrawButtonAsHighlighted, bool shouldDrawButtonAsDown) override;
 };
 #endif /* LookAndFeel_hpp */
@@ -0,0 +1,131 @@
+//
+//  MatchedFilterDesign.cpp
+//  Simple EQ
+//
+//  Copyright © 2022 Hsian. All rights reserved.
+//
+
+#include "MatchedFilterDesign.hpp"
+
+namespace {
+    // Everything is designed in double: the formulas divide by sin^2(w0 / 2),
+    // which gets very small for low cutoffs at high sample rates.
+    struct MatchedPoles{
+        double a1, a2;
+        // |A(e^jw)|^2 = A0 * phi0 + A1 * phi1 + A2 * phi2
+        double A0, A1, A2;
+        double phi0, phi1, phi2;
+    };
+
+    MatchedPoles makeMatchedPoles(double w0, double quality){
+        MatchedPoles p;
+        const auto zeta = 1.0 / (2.0 * quality);
+        if (zeta <= 1.0){
+            p.a1 = -2.0 * std::exp(-zeta * w0) * std::cos(std::sqrt(1.0 - zeta * zeta) * w0);
+        } else {
+            p.a1 = -2.0 * std::exp(-zeta * w0) * std::cosh(std::sqrt(zeta * zeta - 1.0) * w0);
+        }
+        p.a2 = std::exp(-2.0 * zeta * w0);
+
+        p.A0 = (1.0 + p.a1 + p.a2) * (1.0 + p.a1 + p.a2);
+        p.A1 = (1.0 - p.a1 + p.a2) * (1.0 - p.a1 + p.a2);
+        p.A2 = -4.0 * p.a2;
+
+        const auto s = std::sin(w0 * 0.5);
+        p.phi1 = s * s;
+        p.phi0 = 1.0 - p.phi1;
+        p.phi2 = 4.0 * p.phi0 * p.phi1;
+        return p;
+    }
+
+    double getAngularFrequency(double sampleRate, float frequency){
+        jassert(sampleRate > 0.0 && frequency > 0.f);
+        return juce::MathConstants<double>::twoPi * limitToBelowNyquist(frequency, sampleRate) / sampleRate;
+    }
+
+    template<typename FloatType>
+    MatchedCoefficients<FloatType> makeBiquad(double b0, double b1, double b2, double a1, double a2){
+        return new juce::dsp::IIR::Coefficients<FloatType>((FloatType) b0, (FloatType) b1, (FloatType) b2,
+                                                           (FloatType) 1, (FloatType) a1, (FloatType) a2);
+    }
+
+    // Butterworth pole pair k of an order-N filter.
+    double getButterworthQuality(int order, int section){
+        return 1.0 / (2.0 * std::cos(juce::MathConstants<double>::pi * (2 * section + 1) / (2.0 * order)));
+    }
+}
+
+template<typename FloatType>
+MatchedCoefficients<FloatType> makeMatchedPeakFilter(double sampleRate, float frequency, float quality, float gainFactor){
+    const auto w0 = getAngularFrequency(sampleRate, frequency);
+    const auto G = (double) gainFactor;
+    // Same prototype as IIR::Coefficients::makePeakFilter, whose poles have a quality of Q * sqrt(G).
+    const auto p = makeMatchedPoles(w0, quality * std::sqrt(G));
+
+    const auto R1 = (p.A0 * p.phi0 + p.A1 * p.phi1 + p.A2 * p.phi2) * G * G;
+    const auto R2 = (-p.A0 + p.A1 + 4.0 * (p.phi0 - p.phi1) * p.A2) * G * G;
+
+    const auto B0 = p.A0;
+    const auto B2 = (R1 - R2 * p.phi1 - B0) / (4.0 * p.phi1 * p.phi1);
+    const auto B1 = juce::jmax(0.0, R2 + B0 + 4.0 * (p.phi1 - p.phi0) * B2);
+
+    const auto W = 0.5 * (std::sqrt(B0) + std::sqrt(B1));
+    const auto b0 = 0.5 * (W + std::sqrt(juce::jmax(0.0, W * W + B2)));
+    const auto b1 = 0.5 * (std::sqrt(B0) - std::sqrt(B1));
+    const auto b2 = -B2 / (4.0 * b0);
+    return makeBiquad<FloatType>(b0, b1, b2, p.a1, p.a2);
+}
+
+template<typename FloatType>
+MatchedCoefficients<FloatType> makeMatchedLowPass(double sampleRate, float frequency, float quality){
+    const auto w0 = getAngularFrequency(sampleRate, frequency);
+    const auto p = makeMatchedPoles(w0, quality);
+
+    const auto R1 = (p.A0 * p.phi0 + p.A1 * p.phi1 + p.A2 * p.phi2) * quality * quality;
+    const auto B0 = p.A0;
+    const auto B1 = juce::jmax(0.0, (R1 - B0 * p.phi0) / p.phi1);
+
+    const auto b0 = 0.5 * (std::sqrt(B0) + std::sqrt(B1));
+    const auto b1 = std::sqrt(B0) - b0;
+    return makeBiquad<FloatType>(b0, b1, 0.0, p.a1, p.a2);
+}
+
+template<typename FloatType>
+MatchedCoefficients<FloatType> makeMatchedHighPass(double sampleRate, float frequency, float quality){
+    const auto w0 = getAngularFrequency(sampleRate, frequency);
+    const auto p = makeMatchedPoles(w0, quality);
+
+    const auto b0 = std::sqrt(p.A0 * p.phi0 + p.A1 * p.phi1 + p.A2 * p.phi2) * quality / (4.0 * p.phi1);
+    return makeBiquad<FloatType>(b0, -2.0 * b0, b0, p.a1, p.a2);
+}
+
+template<typename FloatType>
+MatchedCoefficientsArray<FloatType> designMatchedButterworthLowPass(float frequency, double sampleRate, int order){
+    jassert(order > 0 && order % 2 == 0);
+    MatchedCoefficientsArray<FloatType> sections;
+    for (int i = 0; i < order / 2; ++i){
+        sections.add(makeMatchedLowPass<FloatType>(sampleRate, frequency, (float) getButterworthQuality(order, i)));
+    }
+    return sections;
+}
+
+template<typename FloatType>
+MatchedCoefficientsArray<FloatType> designMatchedButterworthHighPass(float frequency, double sampleRate, int order){
+    jassert(order > 0 && order % 2 == 0);
+    MatchedCoefficientsArray<FloatType> sections;
+    for (int i = 0; i < order / 2; ++i){
+        sections.add(makeMatchedHighPass<FloatType>(sampleRate, frequency, (float) getButterworthQuality(order, i)));
+    }
+    return sections;
+}
+
+#define INSTANTIATE_MATCHED_FILTER_DESIGN(FloatType) \
+    template MatchedCoefficients<FloatType> makeMatchedPeakFilter<FloatType>(double, float, float, float); \
+    template MatchedCoefficients<FloatType> makeMatchedLowPass<FloatType>(double, float, float); \
+    template MatchedCoefficients<FloatType> makeMatchedHighPass<FloatType>(double, float, float); \
+    template MatchedCoefficientsArray<FloatType> designMatchedButterworthLowPass<FloatType>(float, double, int); \
+    template MatchedCoefficientsArray<FloatType> designMatchedButterworthHighPass<FloatType>(float, double, int);
+
+INSTANTIATE_MATCHED_FILTER_DESIGN(float)
+INSTANTIATE_MATCHED_FILTER_DESIGN(double)
+#undef INSTANTIATE_MATCHED_FILTER_DESIGN
@@ -0,0 +1,46 @@
+//
+//  MatchedFilterDesign.hpp
+//  Simple EQ
+//
+//  Copyright © 2022 Hsian. All rights reserved.
+//
+
+#ifndef MatchedFilterDesign_hpp
+#define MatchedFilterDesign_hpp
+#include <JuceHeader.h>
+
+/*
+ Biquads whose magnitude follows the analog prototype up towards Nyquist
+ (M. Vicanek, "Matched Second Order Digital Filters", 2016), instead
+ of cramping like the bilinear transform does near the top of the band.
+ Poles are impulse-invariant; zeros are solved so the magnitude agrees with
+ the analog response at DC and at the centre frequency. In between, deep
+ peaks close to Nyquist at 44.1/48 kHz can still be a couple of dB off the
+ prototype; Tests/ pins how far.
+ Same cost per sample as any other biquad: only the design differs.
+ */
+template<typename FloatType = float>
+using MatchedCoefficients = typename juce::dsp::IIR::Coefficients<FloatType>::Ptr;
+template<typename FloatType = float>
+using MatchedCoefficientsArray = juce::ReferenceCountedArray<juce::dsp::IIR::Coefficients<FloatType>>;
+
+// The Freq parameters reach 20 kHz, past Nyquist at low sample rates; such bands
+// are designed just below Nyquist instead. Both design paths go through this.
+inline float limitToBelowNyquist(float frequency, double sampleRate){
+    return (float) juce::jmin((double) frequency, 0.49 * sampleRate);
+}
+
+// Instantiated for float and double in MatchedFilterDesign.cpp.
+template<typename FloatType>
+MatchedCoefficients<FloatType> makeMatchedPeakFilter(double sampleRate, float frequency, float quality, float gainFactor);
+template<typename FloatType>
+MatchedCoefficients<FloatType> makeMatchedLowPass(double sampleRate, float frequency, float quality);
+template<typename FloatType>
+MatchedCoefficients<FloatType> makeMatchedHighPass(double sampleRate, float frequency, float quality);
+
+// Same section layout as juce::dsp::FilterDesign's Butterworth methods; order must be even.
+template<typename FloatType>
+MatchedCoefficientsArray<FloatType> designMatchedButterworthLowPass(float frequency, double sampleRate, int order);
+template<typename FloatType>
+MatchedCoefficientsArray<FloatType> designMatchedButterworthHighPass(float frequency, double sampleRate, int order);
+#endif /* MatchedFilterDesign_hpp */
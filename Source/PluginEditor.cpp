@@ -10,9 +10,68 @@
 #include "PluginEditor.h"
 
 
-PathProducer::PathProducer(SingleChannelSampleFifo<SimpleEQAudioProcessor::BlockType>& channelFifo): leftChannelFifo(&channelFifo){
-    leftChannelFFTDataGenerator.changeOrder(FFTOrder::order2048);
-    monoBuffer.setSize(1, leftChannelFFTDataGenerator.getFFTSize());
+PathProducer::PathProducer(SingleChannelSampleFifo& channelFifo): leftChannelFifo(&channelFifo){
+    changeOrder(FFTOrder::order2048);
+    analyzerThread->addClient(this);
+    leftChannelFifo->addConsumer();
+}
+
+PathProducer::~PathProducer(){
+    if (enabled.get()){
+        leftChannelFifo->removeConsumer();
+    }
+    analyzerThread->removeClient(this);
+}
+
+void PathProducer::changeOrder(FFTOrder newOrder){
+    leftChannelFFTDataGenerator.changeOrder(newOrder);
+    ballistics.prepare(leftChannelFFTDataGenerator.getFFTSize() / 2, -48.f);
+    slidingWindow.assign((size_t) leftChannelFFTDataGenerator.getFFTSize(), 0.f);
+    windowWriteIndex = 0;
+    samplesUntilNextFrame = 0;
+}
+
+int PathProducer::getHopSize(double sampleRate, int fftSize){
+    return juce::jlimit(1, fftSize, juce::roundToInt(sampleRate / framesPerSecond));
+}
+
+void PathProducer::setEnabled(bool shouldBeEnabled){
+    if (enabled.exchange(shouldBeEnabled) == shouldBeEnabled){
+        return;
+    }
+    // Only subscribed while someone is looking, so the audio thread can skip the copy.
+    if (shouldBeEnabled){
+        leftChannelFifo->addConsumer();
+    } else {
+        leftChannelFifo->removeConsumer();
+    }
+}
+
+void PathProducer::setAnalysisBounds(juce::Rectangle<float> fftBounds, double sampleRate){
+    {
+        const juce::SpinLock::ScopedLockType sl(boundsLock);
+        analysisBounds = fftBounds;
+        analysisSampleRate = sampleRate;
+    }
+    analyzerThread->notify();
+}
+
+void PathProducer::threadCallback(){
+    if (!enabled.get()){
+        return;
+    }
+    juce::Rectangle<float> fftBounds;
+    double sampleRate;
+    {
+        const juce::SpinLock::ScopedLockType sl(boundsLock);
+        fftBounds = analysisBounds;
+        sampleRate = analysisSampleRate;
+    }
+    if (fftBounds.isEmpty() || sampleRate <= 0.0){
+        // Not laid out yet, or the processor hasn't been prepared.
+        return;
+    }
+    process(fftBounds, sampleRate);
 }
 
 ResponseCurveComponent::ResponseCurveComponent(SimpleEQAudioProcessor& p) :
@@ -26,9 +85,9 @@ rightPathProducer(audioProcessor.rightChannelFifo)
         param -> addListener(this);
     }
     
-    startTimerHz(60);
+    setOpaque(true);
     updateChain();
-    
+    updateActivity();
 }
 ResponseCurveComponent::~ResponseCurveComponent(){
     const auto& params = audioProcessor.getParameters();
@@ -37,169 +96,219 @@ ResponseCurveComponent::~ResponseCurveComponent(){
     }
 }
 void ResponseCurveComponent::parameterValueChanged(int parameterIndex, float newValue){
+    // May be called on the audio thread: only raise the flag, the timer does the rest.
     parametersChanged.set(true);
 }
 
 void PathProducer::process(juce::Rectangle<float> fftBounds, double sampleRate){
-    juce::AudioBuffer<float> tempIncomingBuffer;
-    while (leftChannelFifo->getNumCompleteBuffersAvailable() >0){
-        if (leftChannelFifo->getAudioBuffer(tempIncomingBuffer)){
-            auto size = tempIncomingBuffer.getNumSamples();
-            juce::FloatVectorOperations::copy(monoBuffer.getWritePointer(0, 0),
-                                              monoBuffer.getReadPointer(0, size),
-                                              monoBuffer.getNumSamples() - size);
-            juce::FloatVectorOperations::copy(monoBuffer.getWritePointer(0, monoBuffer.getNumSamples() - size),
-                                              tempIncomingBuffer.getReadPointer(0, 0),
-                                              size);
-            leftChannelFFTDataGenerator.produceFFTDataForRendering(monoBuffer, -48.f);
-            
+    if (requestedOrder.get() != leftChannelFFTDataGenerator.getOrder()){
+        changeOrder(static_cast<FFTOrder>(requestedOrder.get()));
+    }
+    const auto fftSize = (int) slidingWindow.size();
+    const auto hopSize = getHopSize(sampleRate, fftSize);
+    if (samplesUntilNextFrame <= 0 || samplesUntilNextFrame > hopSize){
+        samplesUntilNextFrame = hopSize;
+    }
+    
+    // Read up to the next frame boundary or the end of the ring, whichever comes first.
+    while (leftChannelFifo->getNumSamplesAvailable() > 0){
+        const auto numToRead = juce::jmin(samplesUntilNextFrame, fftSize - windowWriteIndex);
+        const auto numRead = leftChannelFifo->pull(slidingWindow.data() + windowWriteIndex, numToRead);
+        windowWriteIndex = (windowWriteIndex + numRead) % fftSize;
+        samplesUntilNextFrame -= numRead;
+        if (samplesUntilNextFrame == 0){
+            leftChannelFFTDataGenerator.produceFFTDataForRendering(slidingWindow, windowWriteIndex, -48.f);
+            samplesUntilNextFrame = hopSize;
+        }
+        if (numRead < numToRead){
+            break;
         }
     }
-    const auto fftSize = leftChannelFFTDataGenerator.getFFTSize();
-    const auto binWidth = sampleRate/(double) fftSize;
+    // Ballistics advance once per frame; only the settled result becomes a path.
+    const auto frameInterval = (float) (hopSize / sampleRate);
+    bool newFrame = false;
     while(leftChannelFFTDataGenerator.getNumAvailableFFTDataBlocks() > 0) {
-        std::vector<float> fftData;
-        if(leftChannelFFTDataGenerator.getFFTData(fftData)){
-            pathProducer.generatePath(fftData, fftBounds, fftSize, binWidth, -48);
+        if(leftChannelFFTDataGenerator.getFFTData(fftFrame)){
+            ballistics.process(fftFrame.data(), frameInterval);
+            newFrame = true;
         }
     }
-    while(pathProducer.getNumPathsAvailable()){
-        pathProducer.getPath(leftChannelFFTPath);
+    if (!newFrame){
+        return;
     }
+    const auto binWidth = sampleRate/(double) fftSize;
+    auto& paths = pathHandoff.getWriteBuffer();
+    pathProducer.generatePath(ballistics.getAverage(), fftBounds, fftSize, (float) binWidth, -48, paths.spectrum);
+    pathProducer.generatePath(ballistics.getPeaks(), fftBounds, fftSize, (float) binWidth, -48, paths.peaks);
+    pathHandoff.publish();
 }
+
 void ResponseCurveComponent::timerCallback(){
     if (showFFTAnalysis){
+        // The analysis itself runs on the AnalyzerThread; here we only hand it
+        // the current layout and pick up whatever paths it has finished.
         auto sampleRate = audioProcessor.getSampleRate();
         auto fftBounds = getAnalysisArea().toFloat();
+        leftPathProducer.setAnalysisBounds(fftBounds, sampleRate);
+        rightPathProducer.setAnalysisBounds(fftBounds, sampleRate);
 
-        leftPathProducer.process(fftBounds, sampleRate);
-        rightPathProducer.process(fftBounds, sampleRate);
+        const auto newLeftPath = leftPathProducer.pullPath();
+        const auto newRightPath = rightPathProducer.pullPath();
+        if (newLeftPath || newRightPath){
+            repaint(getRenderArea());
+        }
     }
     
+    // Parameter changes, the sample rate and the display scale are all polled here.
+    refreshResponseCurve();
+    if (Component::getApproximateScaleFactorForComponent(this) != backgroundScale){
+        renderBackground();
+        repaint();
+    }
+}
+
+void ResponseCurveComponent::refreshResponseCurve(){
+    // The curve only changes with the parameters, the sample rate or the size (see resized()).
+    if (audioProcessor.getSampleRate() != curveSampleRate){
+        curveSampleRate = audioProcessor.getSampleRate();
+        parametersChanged.set(true);
+        curveGridNeedsUpdate = true;
+    }
     if (parametersChanged.compareAndSetBool(false, true)){
         updateChain();
-        
+        curveNeedsUpdate = true;
+    }
+    if (curveGridNeedsUpdate && curveSampleRate > 0.0){
+        curveGridNeedsUpdate = false;
+        curveResponse.prepare(curveFrequencies, curveSampleRate);
+        curveNeedsUpdate = true;
+    }
+    if (curveNeedsUpdate){
+        curveNeedsUpdate = false;
+        updateResponseCurve();
+        repaint(getRenderArea());
     }
-    repaint();
 }
-void  ResponseCurveComponent::updateChain(){
-    //update monochain
-    auto chainSettings = getChainSettings(audioProcessor.apvts);
-    monoChain.setBypassed<ChainPositions::LowCut>(chainSettings.lowCutBypassed);
-    monoChain.setBypassed<ChainPositions::Peak>(chainSettings.peakBypassed);
-    monoChain.setBypassed<ChainPositions::HighCut>(chainSettings.highCutBypassed);
 
-    auto peakCoefficients = makePeakFilter(chainSettings, audioProcessor.getSampleRate());
-    updateCoefficients(monoChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
-    
-    auto lowCutCoefficients = makeLowCutFilter(chainSettings, audioProcessor.getSampleRate());
-    auto highCutCoefficients = makeHighCutFilter(chainSettings, audioProcessor.getSampleRate());
-    
-    updateCutFilter(monoChain.get<ChainPositions::LowCut>(), lowCutCoefficients, chainSettings.lowCutSlope);
-    updateCutFilter(monoChain.get<ChainPositions::HighCut>(), highCutCoefficients, chainSettings.highCutSlope);
-        
-    
+void ResponseCurveComponent::updateActivity(){
+    // Nothing runs for an editor nobody can see: no timer, no analysis, no capture on the audio thread.
+    const auto showing = isShowing();
+    leftPathProducer.setEnabled(showing && showFFTAnalysis);
+    rightPathProducer.setEnabled(showing && showFFTAnalysis);
+    if (!showing){
+        stopTimer();
+    } else {
+        // Without the analyzer the timer only polls for parameter, sample rate and scale changes,
+        // and repaints nothing unless one of them moved.
+        startTimerHz(showFFTAnalysis ? 60 : 30);
+    }
 }
-void ResponseCurveComponent::paint (juce::Graphics& g)
-{
-    // (Our component is opaque, so we must completely fill the background with a solid colour)
+
+void ResponseCurveComponent::visibilityChanged(){
+    updateActivity();
+}
+
+void ResponseCurveComponent::parentHierarchyChanged(){
+    updateActivity();
+}
+
+void  ResponseCurveComponent::updateChain(){
+    // Same flattened, double-precision design the processor runs.
+    if (curveSampleRate <= 0.0){
+        // Not prepared yet: show a flat line until there is a sample rate to design for.
+        chainCoefficients.stages.fill({1.0, 0.0, 0.0, 0.0, 0.0});
+        chainCoefficients.active.fill(false);
+        return;
+    }
+    chainCoefficients = makeChainCoefficients(getChainSettings(audioProcessor.apvts), curveSampleRate);
+}
+void ResponseCurveComponent::updateResponseCurve(){
     using namespace juce;
-    g.fillAll(Colours::black);
-    g.drawImage(background, getLocalBounds().toFloat());
-    
     auto responseArea = getAnalysisArea();
+    curveMagnitudes.resize((size_t) curveResponse.getNumFrequencies());
+    curveResponse.process(chainCoefficients, curveMagnitudes.data());
     
-    auto w = responseArea.getWidth();
-    auto& lowcut = monoChain.get<ChainPositions::LowCut>();
-    auto& peak = monoChain.get<ChainPositions::Peak>();
-    auto& highcut = monoChain.get<ChainPositions::HighCut>();
-    
-    auto sampleRate = audioProcessor.getSampleRate();
-    
-    std::vector<double> mags;
-    mags.resize(w);
-    
-    for (int i=0; i<w; ++i){
-        double mag = 1.f;
-        auto freq = mapToLog10(double(i)/ double(w), 20.0, 20000.0);
-        if (!monoChain.isBypassed<ChainPositions::Peak>()){
-            mag *= peak.coefficients -> getMagnitudeForFrequency(freq, sampleRate);
-        }
-        if(!monoChain.isBypassed<ChainPositions::LowCut>()){
-            if (!lowcut.isBypassed<0>()){
-                mag *= lowcut.get<0>().coefficients -> getMagnitudeForFrequency(freq, sampleRate);
-            }
-            if (!lowcut.isBypassed<1>()){
-                mag *= lowcut.get<1>().coefficients -> getMagnitudeForFrequency(freq, sampleRate);
-            }
-            if (!lowcut.isBypassed<2>()){
-                mag *= lowcut.get<2>().coefficients -> getMagnitudeForFrequency(freq, sampleRate);
-            }
-            if (!lowcut.isBypassed<3>()){
-                mag *= lowcut.get<3>().coefficients -> getMagnitudeForFrequency(freq, sampleRate);
-            }
-        }
-        
-        if(!monoChain.isBypassed<ChainPositions::HighCut>()){
-            if (!highcut.isBypassed<0>()){
-                mag *= highcut.get<0>().coefficients -> getMagnitudeForFrequency(freq, sampleRate);
-            }
-            if (!highcut.isBypassed<1>()){
-                mag *= highcut.get<1>().coefficients -> getMagnitudeForFrequency(freq, sampleRate);
-            }
-            if (!highcut.isBypassed<2>()){
-                mag *= highcut.get<2>().coefficients -> getMagnitudeForFrequency(freq, sampleRate);
-            }
-            if (!highcut.isBypassed<3>()){
-                mag *= highcut.get<3>().coefficients -> getMagnitudeForFrequency(freq, sampleRate);
-            }
-        }
-       
-        mags[i] = Decibels::gainToDecibels(mag);
+    responseCurve.clear();
+    if (curveMagnitudes.empty()){
+        return;
     }
-    
-    Path responseCurve;
     const double outputMin = responseArea.getBottom();
     const double outputMax = responseArea.getY();
     auto map = [outputMin, outputMax](double input){
         return jmap(input, -24.0, 24.0, outputMin, outputMax);
     };
     
-    responseCurve.startNewSubPath(responseArea.getX(), map(mags.front()));
+    responseCurve.preallocateSpace(3 * (int) curveMagnitudes.size());
+    responseCurve.startNewSubPath(responseArea.getX(), map(curveMagnitudes.front()));
     
-    for (size_t i=1; i< mags.size(); ++i){
-        responseCurve.lineTo(responseArea.getX() + i, map(mags[i]));
+    for (size_t i=1; i< curveMagnitudes.size(); ++i){
+        responseCurve.lineTo(responseArea.getX() + i, map(curveMagnitudes[i]));
     }
-    g.setColour (Colours::orange);
-    g.drawRoundedRectangle(getRenderArea().toFloat(), 4.f, 1.f);
+}
+
+void ResponseCurveComponent::paint (juce::Graphics& g)
+{
+    // (Our component is opaque, so we must completely fill the background with a solid colour)
+    using namespace juce;
+    // The grid, labels and frame are static and cached in background; only the curves are drawn here.
+    g.drawImage(background, getLocalBounds().toFloat());
+    
+    auto responseArea = getAnalysisArea();
     
     g.setColour(Colours::white);
     g.strokePath(responseCurve, PathStrokeType(2.f));
     
     if (showFFTAnalysis){
-        auto leftChannelFFTPath = leftPathProducer.getPath();
-        leftChannelFFTPath.applyTransform(AffineTransform().translation(responseArea.getX(), responseArea.getY()));
-        g.setColour(Colours::skyblue);
-        g.strokePath(leftChannelFFTPath, PathStrokeType(1.f));
-        
-        auto rightChannelFFTPath = rightPathProducer.getPath();
-        rightChannelFFTPath.applyTransform(AffineTransform().translation(responseArea.getX(), responseArea.getY()));
-        
-        g.setColour(Colours::yellow);
-        g.strokePath(rightChannelFFTPath, PathStrokeType(1.f));
+        auto translation = AffineTransform().translation(responseArea.getX(), responseArea.getY());
+        auto drawAnalyzerPaths = [&g, translation](const AnalyzerPaths& paths, Colour colour){
+            g.setColour(colour.withAlpha(0.4f));
+            g.strokePath(paths.peaks, PathStrokeType(1.f), translation);
+            g.setColour(colour);
+            g.strokePath(paths.spectrum, PathStrokeType(1.f), translation);
+        };
+        drawAnalyzerPaths(leftPathProducer.getPaths(), Colours::skyblue);
+        drawAnalyzerPaths(rightPathProducer.getPaths(), Colours::yellow);
     }
     
 }
 
 void ResponseCurveComponent::toggleAnalysisEnablement(bool enabled){
     showFFTAnalysis = enabled;
+    updateActivity();
+    repaint(getRenderArea());
+}
+
+void ResponseCurveComponent::setFFTOrder(FFTOrder newOrder){
+    leftPathProducer.setFFTOrder(newOrder);
+    rightPathProducer.setFFTOrder(newOrder);
 }
 
 void ResponseCurveComponent::resized(){
     using namespace juce;
-    background = Image(Image::PixelFormat::RGB, getWidth(), getHeight(), true);
+    // One frequency per pixel column, worked out once per size.
+    auto curveWidth = getAnalysisArea().getWidth();
+    curveFrequencies.resize((size_t) jmax(0, curveWidth));
+    for (int i = 0; i < curveWidth; ++i){
+        curveFrequencies[(size_t) i] = mapToLog10(double(i) / double(curveWidth), 20.0, 20000.0);
+    }
+    curveGridNeedsUpdate = true;
+    refreshResponseCurve();
+    renderBackground();
+}
+
+void ResponseCurveComponent::renderBackground(){
+    using namespace juce;
+    // Rendered at the display's scale so the grid and labels stay sharp on high-DPI screens.
+    backgroundScale = Component::getApproximateScaleFactorForComponent(this);
+    background = Image(Image::PixelFormat::RGB,
+                       jmax(1, roundToInt(getWidth() * backgroundScale)),
+                       jmax(1, roundToInt(getHeight() * backgroundScale)),
+                       true);
     
     Graphics g (background);
+    g.addTransform(AffineTransform::scale(backgroundScale));
+    g.setColour (Colours::orange);
+    g.drawRoundedRectangle(getRenderArea().toFloat(), 4.f, 1.f);
     
     Array<float> freqs{
         20, /* 30, 40, */ 50, 100,
@@ -326,7 +435,9 @@ highCutSlopeSliderAttachment(audioProcessor.apvts, "HighCut Slope", highCutSlope
 lowCutBypassButtonAttachment(audioProcessor.apvts, "LowCut Bypassed", lowCutBypassButton),
 peakBypassButtonAttachment(audioProcessor.apvts, "Peak Bypassed", peakBypassButton),
 highCutBypassButtonAttachment(audioProcessor.apvts, "HighCut Bypassed", highCutBypassButton),
-analyzerEnabledButtonAttachment(audioProcessor.apvts, "Analyzer Enabled", analyzerEnabledButton)
+analyzerEnabledButtonAttachment(audioProcessor.apvts, "Analyzer Enabled", analyzerEnabledButton),
+analogMatchedButtonAttachment(audioProcessor.apvts, "Analog Matched", analogMatchedButton),
+linearPhaseButtonAttachment(audioProcessor.apvts, "Linear Phase", linearPhaseButton)
 {
     peakFreqSlider.labels.add({0.f, "20Hz"});
     peakFreqSlider.labels.add({1.f, "20kHz"});
@@ -387,12 +498,26 @@ analyzerEnabledButtonAttachment(audioProcessor.apvts, "Analyzer Enabled", analyz
         }
     };
     
+    configureAnalyzerSourceBox(leftAnalyzerSourceBox, audioProcessor.leftChannelFifo);
+    configureAnalyzerSourceBox(rightAnalyzerSourceBox, audioProcessor.rightChannelFifo);
+    
     analyzerEnabledButton.onClick = [safePtr] {
         if (auto comp = safePtr.getComponent()){
             auto enabled = comp->analyzerEnabledButton.getToggleState();
             comp->responseCurveComponent.toggleAnalysisEnablement(enabled);
         }
     };
+    responseCurveComponent.toggleAnalysisEnablement(analyzerEnabledButton.getToggleState());
+    
+    analyzerOrderBox.addItem("2048", FFTOrder::order2048);
+    analyzerOrderBox.addItem("4096", FFTOrder::order4096);
+    analyzerOrderBox.addItem("8192", FFTOrder::order8192);
+    analyzerOrderBox.setSelectedId(FFTOrder::order2048, juce::dontSendNotification);
+    analyzerOrderBox.onChange = [safePtr](){
+        if (auto comp = safePtr.getComponent()){
+            comp->responseCurveComponent.setFFTOrder(static_cast<FFTOrder>(comp->analyzerOrderBox.getSelectedId()));
+        }
+    };
     
     setSize (600, 480);
 }
@@ -425,6 +550,12 @@ void SimpleEQAudioProcessorEditor::resized()
     analyzerEnabledArea.setX(2);
     analyzerEnabledArea.removeFromTop(2);
     analyzerEnabledButton.setBounds(analyzerEnabledArea);
+    analogMatchedButton.setBounds(analyzerEnabledArea.translated(analyzerEnabledArea.getWidth() + 4, 0).withWidth(130));
+    linearPhaseButton.setBounds(analogMatchedButton.getBounds().translated(analogMatchedButton.getWidth() + 4, 0).withWidth(110));
+    auto analyzerSourceArea = analyzerEnabledArea.withX(bounds.getRight() - 2 * 84).withWidth(82);
+    leftAnalyzerSourceBox.setBounds(analyzerSourceArea);
+    rightAnalyzerSourceBox.setBounds(analyzerSourceArea.translated(84, 0));
+    analyzerOrderBox.setBounds(analyzerSourceArea.translated(-74, 0).withWidth(70));
     bounds.removeFromTop(5);
     
     float hRatio = 25.f / 100.f;
@@ -451,6 +582,25 @@ void SimpleEQAudioProcessorEditor::resized()
 
 }
 
+void SimpleEQAudioProcessorEditor::configureAnalyzerSourceBox(juce::ComboBox& box, SingleChannelSampleFifo& channelFifo){
+    // Item ids are the channel index + 2, leaving id 1 for the downmix.
+    constexpr int downmixId = 1;
+    box.addItem("Downmix", downmixId);
+    auto layout = audioProcessor.getChannelLayoutOfBus(true, 0);
+    for (int ch = 0; ch < layout.size(); ++ch){
+        auto name = juce::AudioChannelSet::getAbbreviatedChannelTypeName(layout.getTypeOfChannel(ch));
+        box.addItem(name.isNotEmpty() ? name : juce::String(ch + 1), ch + 2);
+    }
+    auto source = channelFifo.getSource();
+    box.setSelectedId(juce::isPositiveAndBelow(source, layout.size()) ? source + 2 : downmixId, juce::dontSendNotification);
+    
+    auto* fifo = &channelFifo;
+    box.onChange = [&box, fifo](){
+        auto id = box.getSelectedId();
+        fifo->setSource(id == downmixId ? SingleChannelSampleFifo::downmixSource : id - 2);
+    };
+}
+
 std::vector<juce::Component*> SimpleEQAudioProcessorEditor::getComps(){
     return {
         &peakFreqSlider,
@@ -464,6 +614,11 @@ std::vector<juce::Component*> SimpleEQAudioProcessorEditor::getComps(){
         &lowCutBypassButton,
         &peakBypassButton,
         &highCutBypassButton,
-        &analyzerEnabledButton
+        &analyzerEnabledButton,
+        &analogMatchedButton,
+        &linearPhaseButton,
+        &leftAnalyzerSourceBox,
+        &rightAnalyzerSourceBox,
+        &analyzerOrderBox
     };
 }
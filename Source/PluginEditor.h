@@ -12,6 +12,9 @@
 #include "PluginProcessor.h"
 #include "LookAndFeel.hpp"
 #include "RotarySliderWithLabels.hpp"
+#include "AnalyzerThread.hpp"
+#include "SpectrumKernels.hpp"
+#include "CascadeResponse.hpp"
 
 //==============================================================================
 /**
@@ -25,21 +28,20 @@ enum FFTOrder{
 
 template<typename BlockType>
 struct FFTDataGenerator{
-    void produceFFTDataForRendering(const juce::AudioBuffer<float>& audioData, const float negativeInfinity){
+    // ring holds the last fftSize samples as a circular buffer; oldestIndex is where the oldest one sits.
+    void produceFFTDataForRendering(const std::vector<float>& ring, int oldestIndex, const float negativeInfinity){
         const auto fftSize = getFFTSize();
-        fftData.assign(fftData.size(), 0);
-        auto* readIndex = audioData.getReadPointer(0);
-        std::copy(readIndex, readIndex + fftSize, fftData.begin());
+        jassert((int) ring.size() == fftSize);
+        // Unrolling the ring and applying the window happen in the same pass.
+        const auto numNewest = fftSize - oldestIndex;
+        juce::FloatVectorOperations::multiply(fftData.data(), ring.data() + oldestIndex, windowTable.data(), numNewest);
+        juce::FloatVectorOperations::multiply(fftData.data() + numNewest, ring.data(), windowTable.data() + numNewest, oldestIndex);
+        std::fill(fftData.begin() + fftSize, fftData.end(), 0.f);
         
-        window->multiplyWithWindowingTable(fftData.data(), fftSize);
         forwardFFT->performFrequencyOnlyForwardTransform(fftData.data());
+        // Normalise, clamp and convert to dB in one pass, in place.
         int numBins = (int)fftSize/2;
-        for (int i =0; i< numBins; ++i){
-            fftData[i]/= (float) numBins;
-        }
-        for (int i =0; i< numBins; ++i){
-            fftData[i] = juce::Decibels::gainToDecibels(fftData[i], negativeInfinity);
-        }
+        SpectrumKernels::magnitudesToDecibels(fftData.data(), numBins, 1.f / (float) numBins, negativeInfinity);
         fftDataFifo.push(fftData);
         
     }
@@ -48,7 +50,9 @@ struct FFTDataGenerator{
         auto fftSize = getFFTSize();
         
         forwardFFT = std::make_unique<juce::dsp::FFT>(order);
-        window = std::make_unique<juce::dsp::WindowingFunction<float>>(fftSize, juce::dsp::WindowingFunction<float>::blackmanHarris);
+        windowTable.resize((size_t) fftSize);
+        juce::dsp::WindowingFunction<float>::fillWindowingTables(windowTable.data(), (size_t) fftSize,
+                                                                 juce::dsp::WindowingFunction<float>::blackmanHarris, true);
         
         fftData.clear();
         fftData.resize(fftSize * 2, 0);
@@ -56,75 +60,144 @@ struct FFTDataGenerator{
         
     }
     int getFFTSize() const {return 1 << order;}
+    FFTOrder getOrder() const {return order;}
     int getNumAvailableFFTDataBlocks() const { return fftDataFifo.getNumAvailableForReading();}
     bool getFFTData(BlockType& fftData) {return fftDataFifo.pull(fftData);}
 private:
     FFTOrder order;
     BlockType fftData;
     std::unique_ptr<juce::dsp::FFT> forwardFFT;
-    std::unique_ptr< juce::dsp::WindowingFunction<float>> window;
+    std::vector<float> windowTable;
     Fifo<BlockType> fftDataFifo;
 };
 
 
+/*
+ Turns a dB spectrum into a path at most two points per pixel column wide.
+ Which bins land in which column is worked out once per layout, sample rate
+ and FFT size; each frame then only takes the min and max of every column.
+ */
 template<typename PathType>
 struct AnalyzerPathGenerator{
+    // Rebuilds path in place so its storage is reused from frame to frame.
     void generatePath(const std::vector<float>& renderData,
                       juce::Rectangle<float> fftBounds,
                       int fftSize,
                       float binWidth,
-                      float negativeInfinity){
+                      float negativeInfinity,
+                      PathType& p){
         auto top = fftBounds.getY();
         auto bottom = fftBounds.getHeight();
-        auto width = fftBounds.getWidth();
-        int numBins = (int) fftSize/2;
-        PathType p;
-        p.preallocateSpace(3 * (int)fftBounds.getWidth());
+        updateColumns((int) fftBounds.getWidth(), fftSize, binWidth);
+        const auto numColumns = (int) columnFirstBin.size() - 1;
+        
+        p.clear();
+        p.preallocateSpace(3 * 2 * numColumns);
         auto map = [bottom, top, negativeInfinity](float v){
             return juce::jmap(v, negativeInfinity, 0.f, float(bottom), top);
         };
-        auto y  = map(renderData[0]);
-        jassert(!std::isnan(y) && !std::isinf(y));
-        p.startNewSubPath(0, y);
-        const int pathResolution = 2;
-        for (int binNum = 1; binNum < numBins; binNum += pathResolution){
-            auto y  = map(renderData[binNum]);
+        bool started = false;
+        for (int column = 0; column < numColumns; ++column){
+            const auto first = renderData.begin() + columnFirstBin[(size_t) column];
+            const auto last = renderData.begin() + columnFirstBin[(size_t) column + 1];
+            if (first == last){
+                // Low frequencies: fewer bins than columns, the line just spans the gap.
+                continue;
+            }
+            const auto [lowest, highest] = std::minmax_element(first, last);
+            const auto x = (float) column;
+            auto y = map(*highest);
             jassert(!std::isnan(y) && !std::isinf(y));
-            if (!std::isnan(y) && !std::isinf(y)){
-                auto binFreq = binNum * binWidth;
-                auto normalizedBinX = juce::mapFromLog10(binFreq, 20.f, 20000.f);
-                int binX = std::floor(normalizedBinX * width);
-                p.lineTo(binX, y);
+            if (!started){
+                p.startNewSubPath(x, y);
+                started = true;
+            } else {
+                p.lineTo(x, y);
+            }
+            if (last - first > 1){
+                p.lineTo(x, map(*lowest));
             }
-            
         }
-        pathFifo.push(p);
-        
-    }
-    int getNumPathsAvailable() const {
-        return pathFifo.getNumAvailableForReading();
     }
+private:
+    // Bins of column c are [columnFirstBin[c], columnFirstBin[c + 1]).
+    std::vector<int> columnFirstBin;
+    int columnsWidth = -1, columnsFFTSize = -1;
+    float columnsBinWidth = -1.f;
     
-    bool getPath(PathType& path){
-        return pathFifo.pull(path);
+    void updateColumns(int width, int fftSize, float binWidth){
+        if (width == columnsWidth && fftSize == columnsFFTSize && binWidth == columnsBinWidth){
+            return;
+        }
+        columnsWidth = width;
+        columnsFFTSize = fftSize;
+        columnsBinWidth = binWidth;
+        
+        // Everything below 20 Hz piles into the first column; nothing above 20 kHz is drawn.
+        const auto numColumns = juce::jmax(1, width + 1);
+        const auto endBin = juce::jmin(fftSize / 2, (int) std::floor(20000.f / binWidth) + 1);
+        columnFirstBin.resize((size_t) numColumns + 1);
+        int bin = 0;
+        for (int column = 0; column < numColumns; ++column){
+            columnFirstBin[(size_t) column] = bin;
+            while (bin < endBin
+                   && (int) std::floor(juce::mapFromLog10(juce::jmax(20.f, bin * binWidth), 20.f, 20000.f) * width) <= column){
+                ++bin;
+            }
+        }
+        columnFirstBin.back() = bin;
     }
-private:
-    Fifo<PathType> pathFifo;
 };
 
+struct AnalyzerPaths {
+    juce::Path spectrum;
+    juce::Path peaks;
+};
 
+/*
+ Runs on the shared AnalyzerThread: drains its channel fifo, runs the FFTs and
+ builds the path. The message thread only picks up the latest finished path.
 
-struct PathProducer {
-    PathProducer(SingleChannelSampleFifo<SimpleEQAudioProcessor::BlockType>&);
-    void process(juce::Rectangle<float> fftBounds, double sampleRate);
-    juce::Path getPath() {return leftChannelFFTPath;}
+ Samples land in a circular window that is never shifted. A new frame is
+ analysed every hop, sized from the display rate rather than the host's
+ block size.
+ */
+struct PathProducer : ClientThread::Client {
+    PathProducer(SingleChannelSampleFifo&);
+    ~PathProducer() override;
+    void threadCallback() override;
+    
+    // Message thread. The editor calls setAnalysisBounds() every frame, which also
+    // wakes the AnalyzerThread to analyse whatever has arrived since.
+    void setAnalysisBounds(juce::Rectangle<float> fftBounds, double sampleRate);
+    void setEnabled(bool shouldBeEnabled);
+    void setFFTOrder(FFTOrder newOrder) {requestedOrder.set(newOrder);}
+    bool pullPath() {return pathHandoff.pull();}
+    const AnalyzerPaths& getPaths() const {return pathHandoff.getReadBuffer();}
 private:
-    SingleChannelSampleFifo<SimpleEQAudioProcessor::BlockType>* leftChannelFifo;
-    juce::AudioBuffer<float> monoBuffer;
+    void process(juce::Rectangle<float> fftBounds, double sampleRate);
+    void changeOrder(FFTOrder newOrder);
+    static int getHopSize(double sampleRate, int fftSize);
+    
+    // About one frame per repaint; finer hops only cost FFTs nobody sees.
+    static constexpr double framesPerSecond = 60.0;
+    
+    SingleChannelSampleFifo* leftChannelFifo;
+    std::vector<float> slidingWindow;
+    int windowWriteIndex = 0, samplesUntilNextFrame = 0;
+    juce::Atomic<int> requestedOrder {FFTOrder::order2048};
     
     FFTDataGenerator<std::vector<float>> leftChannelFFTDataGenerator;
+    std::vector<float> fftFrame;
+    SpectrumKernels::Ballistics ballistics;
     AnalyzerPathGenerator<juce::Path> pathProducer;
-    juce::Path leftChannelFFTPath;
+    
+    juce::SpinLock boundsLock;
+    juce::Rectangle<float> analysisBounds;
+    double analysisSampleRate = 0.0;
+    juce::Atomic<bool> enabled {true};
+    TripleBuffer<AnalyzerPaths> pathHandoff;
+    juce::SharedResourcePointer<AnalyzerThread> analyzerThread;
 };
 
 struct ResponseCurveComponent : juce::Component, juce::AudioProcessorParameter::Listener, juce::Timer{
@@ -137,15 +210,32 @@ struct ResponseCurveComponent : juce::Component, juce::AudioProcessorParameter::
     
     void paint(juce::Graphics& g) override;
     void resized() override;
+    void visibilityChanged() override;
+    void parentHierarchyChanged() override;
     
     void toggleAnalysisEnablement(bool enabled);
+    void setFFTOrder(FFTOrder newOrder);
 private:
     juce::Atomic<bool> parametersChanged {false};
     SimpleEQAudioProcessor& audioProcessor;
-    MonoChain monoChain;
+    ChainCoefficients chainCoefficients;
     void updateChain();
     
+    // The response curve is cached and only rebuilt when it can have changed.
+    std::vector<double> curveFrequencies, curveMagnitudes;
+    CascadeResponse curveResponse;
+    juce::Path responseCurve;
+    double curveSampleRate = 0.0;
+    bool curveGridNeedsUpdate = true, curveNeedsUpdate = true;
+    void updateResponseCurve();
+    void refreshResponseCurve();
+    
     juce::Image background;
+    float backgroundScale = 1.f;
+    void renderBackground();
+    
+    // Repaints are driven by new paths and curve changes only; see updateActivity().
+    void updateActivity();
     
     juce::Rectangle<int> getRenderArea();
     juce::Rectangle<int> getAnalysisArea();
@@ -179,8 +269,14 @@ private:
     
     PowerButton lowCutBypassButton, peakBypassButton, highCutBypassButton;
     AnalyzerButton analyzerEnabledButton;
+    juce::ToggleButton analogMatchedButton {"Analog Matched"}, linearPhaseButton {"Linear Phase"};
     using ButtonAttachment = APVTS::ButtonAttachment;
-    ButtonAttachment lowCutBypassButtonAttachment, peakBypassButtonAttachment, highCutBypassButtonAttachment, analyzerEnabledButtonAttachment;
+    ButtonAttachment lowCutBypassButtonAttachment, peakBypassButtonAttachment, highCutBypassButtonAttachment, analyzerEnabledButtonAttachment, analogMatchedButtonAttachment, linearPhaseButtonAttachment;
+    
+    // Pick which channel (or a downmix) each analyzer tap listens to.
+    juce::ComboBox leftAnalyzerSourceBox, rightAnalyzerSourceBox;
+    juce::ComboBox analyzerOrderBox;
+    void configureAnalyzerSourceBox(juce::ComboBox& box, SingleChannelSampleFifo& channelFifo);
     
     std::vector<juce::Component*> getComps();
     
@@ -7,7 +7,10 @@
 */
 
 #include "PluginProcessor.h"
-#include "PluginEditor.h"
+#if ! SIMPLE_EQ_HEADLESS
+ #include "PluginEditor.h"
+#endif
+#include "BiquadCascade.hpp"
 
 //==============================================================================
 SimpleEQAudioProcessor::SimpleEQAudioProcessor()
@@ -22,10 +25,19 @@ SimpleEQAudioProcessor::SimpleEQAudioProcessor()
                        )
 #endif
 {
+    for (auto* param: getParameters()){
+        param -> addListener(this);
+    }
+    designThread->addClient(this);
+    analyzerEnabled = apvts.getRawParameterValue("Analyzer Enabled");
 }
 
 SimpleEQAudioProcessor::~SimpleEQAudioProcessor()
 {
+    designThread->removeClient(this);
+    for (auto* param: getParameters()){
+        param -> removeListener(this);
+    }
 }
 
 //==============================================================================
@@ -95,21 +107,39 @@ void SimpleEQAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlo
 {
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
-    juce::dsp::ProcessSpec spec;
-    spec.maximumBlockSize = samplesPerBlock;
-    spec.numChannels = 1;
-    spec.sampleRate = sampleRate;
-    leftChain.prepare(spec);
-    rightChain.prepare(spec);
+    const auto numChannels = juce::jmax(getTotalNumInputChannels(), getTotalNumOutputChannels());
+    if (isUsingDoublePrecision()){
+        doubleCascade.prepare(numChannels, samplesPerBlock);
+        floatCascade.release();
+        linearPhaseScratch.setSize(numChannels, samplesPerBlock);
+        doubleModeFadeScratch.setSize(numChannels, samplesPerBlock);
+        floatModeFadeScratch.setSize(0, 0);
+    } else {
+        floatCascade.prepare(numChannels, samplesPerBlock);
+        doubleCascade.release();
+        linearPhaseScratch.setSize(0, 0);
+        floatModeFadeScratch.setSize(numChannels, samplesPerBlock);
+        doubleModeFadeScratch.setSize(0, 0);
+    }
+    
+    coefficientRamp.reset(sampleRate, coefficientRampSeconds);
+    coefficientRamp.setCurrentAndTargetValue(1.f);
+    coefficientsNeedJump = true;
+    modeFadeRemaining = 0;
     
-    updateFilters();
+    {
+        const RealtimeSafety::ScopedLock sl(designLock);
+        firOrder = LinearPhaseConvolver::getFIROrderForSampleRate(sampleRate);
+        linearPhaseConvolver.prepare(firOrder, numChannels);
+        linearPhaseActive = false;
+    }
+    
+    parametersChanged.set(false);
+    designCoefficients(sampleRate);
+    handleAsyncUpdate();
     
     leftChannelFifo.prepare(samplesPerBlock);
     rightChannelFifo.prepare(samplesPerBlock);
-    osc.initialise([](float x){return std::sin(x);});
-    spec.numChannels = getTotalNumOutputChannels();
-    osc.prepare(spec);
-    osc.setFrequency(200);
 }
 
 void SimpleEQAudioProcessor::releaseResources()
@@ -125,12 +155,8 @@ bool SimpleEQAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
     juce::ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Any channel count is fine: channels are filtered in SIMD groups.
+    if (layouts.getMainOutputChannelSet().isDisabled())
         return false;
 
     // This checks if the input layout matches the output layout
@@ -145,6 +171,19 @@ bool SimpleEQAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
 #endif
 
 void SimpleEQAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    const RealtimeSafety::ScopedProcessBlock realtimeScope(realtimeStats, buffer.getNumSamples(), getSampleRate());
+    processSamples(buffer);
+}
+
+void SimpleEQAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    const RealtimeSafety::ScopedProcessBlock realtimeScope(realtimeStats, buffer.getNumSamples(), getSampleRate());
+    processSamples(buffer);
+}
+
+template<typename SampleType>
+void SimpleEQAudioProcessor::processSamples(juce::AudioBuffer<SampleType>& buffer)
 {
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels  = getTotalNumInputChannels();
@@ -159,37 +198,165 @@ void SimpleEQAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juc
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
         
-    updateFilters();
+    pullPendingCoefficients();
     
-    juce::dsp::AudioBlock<float> block(buffer);
-//    buffer.clear();
-//    
-//    juce::dsp::ProcessContextReplacing<float> stereoContext(block);
-//    osc.process(stereoContext);
+    juce::dsp::AudioBlock<SampleType> block(buffer);
     
-    auto leftBlock = block.getSingleChannelBlock(0);
-    auto rightBlock = block.getSingleChannelBlock(1);
-
-    juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
-    juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
+    if (kernelHandoff.pull()){
+        linearPhaseConvolver.setKernel(kernelHandoff.getReadBuffer());
+    }
+    if (modeFadeRemaining == 0 && linearPhaseActive != rampTarget.linearPhase){
+        // The incoming path starts from silence: the convolver from an empty
+        // history, the cascades from zero state.
+        linearPhaseActive = rampTarget.linearPhase;
+        if (linearPhaseActive){
+            linearPhaseConvolver.reset();
+        } else if (isUsingDoublePrecision()){
+            doubleCascade.reset();
+        } else {
+            floatCascade.reset();
+        }
+        modeFadeRemaining = modeFadeLength;
+    }
     
-    leftChain.process(leftContext);
-    rightChain.process(rightContext);
+    auto& fadeScratch = getModeFadeScratch(SampleType());
+    size_t startSample = 0;
+    while (modeFadeRemaining > 0 && startSample < block.getNumSamples()){
+        if (fadeScratch.getNumSamples() == 0){
+            // Not prepared: there is no scratch to crossfade through.
+            jassertfalse;
+            modeFadeRemaining = 0;
+            break;
+        }
+        const auto numToFade = juce::jmin(block.getNumSamples() - startSample, (size_t) modeFadeRemaining,
+                                          (size_t) fadeScratch.getNumSamples());
+        const auto numChannels = juce::jmin(block.getNumChannels(), (size_t) fadeScratch.getNumChannels());
+        auto subBlock = block.getSubsetChannelBlock(0, numChannels).getSubBlock(startSample, numToFade);
+        auto incoming = juce::dsp::AudioBlock<SampleType>(fadeScratch).getSubsetChannelBlock(0, numChannels)
+                                                                     .getSubBlock(0, numToFade);
+        crossfadeModes(subBlock, incoming);
+        modeFadeRemaining -= (int) numToFade;
+        startSample += numToFade;
+    }
+    if (startSample < block.getNumSamples()){
+        auto remaining = block.getSubBlock(startSample);
+        processMode(remaining, linearPhaseActive);
+    }
     
-    leftChannelFifo.update(buffer);
-    rightChannelFifo.update(buffer);
+    // Each tap returns straight away unless an editor has subscribed to it.
+    if (analyzerEnabled->load() > 0.5f){
+        leftChannelFifo.update(buffer);
+        rightChannelFifo.update(buffer);
+    }
+}
+
+template<typename SampleType>
+void SimpleEQAudioProcessor::processMode(juce::dsp::AudioBlock<SampleType>& block, bool linearPhase){
+    if (linearPhase){
+        processLinearPhase(block);
+    } else {
+        processMinimumPhase(block);
+    }
+}
+
+template<typename SampleType>
+void SimpleEQAudioProcessor::processMinimumPhase(juce::dsp::AudioBlock<SampleType>& block){
+    // While a ramp is running, split the block so coefficients move every
+    // controlRate samples whatever the host block size is. Once settled on a
+    // flat curve there is nothing left to do: the audio passes through untouched.
+    const auto numSamples = (int) block.getNumSamples();
+    int startSample = 0;
+    while (startSample < numSamples && (!currentIsIdentity || coefficientRamp.isSmoothing())){
+        auto numToProcess = numSamples - startSample;
+        if (coefficientRamp.isSmoothing()){
+            numToProcess = juce::jmin(numToProcess, controlRate);
+            advanceCoefficientRamp(numToProcess);
+        }
+        auto subBlock = block.getSubBlock((size_t) startSample, (size_t) numToProcess);
+        processCascades(subBlock);
+        startSample += numToProcess;
+    }
+}
+
+template<typename SampleType>
+void SimpleEQAudioProcessor::crossfadeModes(juce::dsp::AudioBlock<SampleType>& block, juce::dsp::AudioBlock<SampleType>& incoming){
+    // Both paths run over the fade, mixed with linear gains that pick up where the
+    // last block left off, as the convolver does between kernels. The incoming
+    // path's input is faded rather than its output, so the convolver rises out
+    // of silence once its latency has passed instead of starting on a step.
+    const auto fadePosition = modeFadeLength - modeFadeRemaining;
+    auto getGain = [fadePosition](size_t i){
+        return (SampleType) (fadePosition + (int) i) / (SampleType) modeFadeLength;
+    };
+    incoming.copyFrom(block);
+    for (size_t ch = 0; ch < incoming.getNumChannels(); ++ch){
+        auto* data = incoming.getChannelPointer(ch);
+        for (size_t i = 0; i < incoming.getNumSamples(); ++i){
+            data[i] *= getGain(i);
+        }
+    }
+    processMode(incoming, linearPhaseActive);
+    processMode(block, !linearPhaseActive);
+    for (size_t ch = 0; ch < block.getNumChannels(); ++ch){
+        auto* data = block.getChannelPointer(ch);
+        auto* incomingData = incoming.getChannelPointer(ch);
+        for (size_t i = 0; i < block.getNumSamples(); ++i){
+            data[i] = data[i] * (1 - getGain(i)) + incomingData[i];
+        }
+    }
+}
 
+void SimpleEQAudioProcessor::processLinearPhase(juce::dsp::AudioBlock<float>& block){
+    linearPhaseConvolver.process(block);
+}
+
+void SimpleEQAudioProcessor::processLinearPhase(juce::dsp::AudioBlock<double>& block){
+    if (linearPhaseScratch.getNumSamples() == 0){
+        // Not prepared for double precision: there is no scratch to convert through.
+        jassertfalse;
+        return;
+    }
+    const auto numChannels = juce::jmin((int) block.getNumChannels(), linearPhaseScratch.getNumChannels());
+    for (int start = 0; start < (int) block.getNumSamples(); start += linearPhaseScratch.getNumSamples()){
+        const auto numSamples = juce::jmin((int) block.getNumSamples() - start, linearPhaseScratch.getNumSamples());
+        for (int ch = 0; ch < numChannels; ++ch){
+            auto* source = block.getChannelPointer((size_t) ch) + start;
+            auto* scratch = linearPhaseScratch.getWritePointer(ch);
+            for (int i = 0; i < numSamples; ++i){
+                scratch[i] = static_cast<float>(source[i]);
+            }
+        }
+        auto scratchBlock = juce::dsp::AudioBlock<float>(linearPhaseScratch).getSubsetChannelBlock(0, (size_t) numChannels)
+                                                                            .getSubBlock(0, (size_t) numSamples);
+        linearPhaseConvolver.process(scratchBlock);
+        for (int ch = 0; ch < numChannels; ++ch){
+            auto* scratch = linearPhaseScratch.getReadPointer(ch);
+            auto* destination = block.getChannelPointer((size_t) ch) + start;
+            for (int i = 0; i < numSamples; ++i){
+                destination[i] = scratch[i];
+            }
+        }
+    }
 }
 
 //==============================================================================
+// SIMPLE_EQ_HEADLESS builds (the batch renderer) link the processor without any of the editor code.
 bool SimpleEQAudioProcessor::hasEditor() const
 {
+   #if SIMPLE_EQ_HEADLESS
+    return false;
+   #else
     return true; // (change this to false if you choose to not supply an editor)
+   #endif
 }
 
 juce::AudioProcessorEditor* SimpleEQAudioProcessor::createEditor()
 {
+   #if SIMPLE_EQ_HEADLESS
+    return nullptr;
+   #else
     return new SimpleEQAudioProcessorEditor (*this);
+   #endif
 }
 
 //==============================================================================
@@ -198,8 +365,7 @@ void SimpleEQAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
     // You should use this method to store your parameters in the memory block.
     // You could do that either as raw data, or use the XML or ValueTree classes
     // as intermediaries to make it easy to save and load complex data.
-    juce::MemoryOutputStream mos(destData, true);
-    apvts.state.writeToStream(mos);
+    PluginState::write(getParameters(), destData);
 }
 
 void SimpleEQAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
@@ -207,70 +373,155 @@ void SimpleEQAudioProcessor::setStateInformation (const void* data, int sizeInBy
     
     // You should use this method to restore your parameters from this memory block,
     // whose contents will have been created by the getStateInformation() call.
-    auto tree = juce::ValueTree::readFromData(data, sizeInBytes);
-    if (tree.isValid()){
-        apvts.replaceState(tree);
-        updateFilters();
+    // Nothing is designed here: the design thread (or prepareToPlay, if we aren't
+    // prepared yet) picks the whole new state up once it has been written.
+    restoringState.set(true);
+    if (!PluginState::read(data, sizeInBytes, getParameters())){
+        // Sessions saved before the compact format hold the apvts ValueTree.
+        auto tree = juce::ValueTree::readFromData(data, sizeInBytes);
+        if (tree.isValid()){
+            apvts.replaceState(tree);
+        }
     }
+    restoringState.set(false);
+    designThread->notify();
 }
 
-Coefficients makePeakFilter(const ChainSettings& chainSettings,double sampleRate){
-    return juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate,
-                                                        chainSettings.peakFreq,
-                                                        chainSettings.peakQuality,
-                                                        juce::Decibels::decibelsToGain(chainSettings.peakGainInDecibels));
+RealtimeSafety::Report SimpleEQAudioProcessor::getRealtimeReport() const{
+    auto report = realtimeStats.getReport();
+    report.leftAnalyzerOverruns = leftChannelFifo.getNumOverruns();
+    report.rightAnalyzerOverruns = rightChannelFifo.getNumOverruns();
+    return report;
 }
 
-void SimpleEQAudioProcessor::updatePeakFilter(const ChainSettings &chainSettings){
-    
-    auto peakCoefficients = makePeakFilter(chainSettings, getSampleRate());
-    
-    leftChain.setBypassed<ChainPositions::Peak>(chainSettings.peakBypassed);
-    rightChain.setBypassed<ChainPositions::Peak>(chainSettings.peakBypassed);
-    
-    updateCoefficients(leftChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
-    updateCoefficients(rightChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
-};
+void SimpleEQAudioProcessor::parameterValueChanged(int parameterIndex, float newValue){
+    // Hosts call this on the audio thread during automation, where signalling the
+    // design thread could block: only raise the flag and let the thread's poll find it.
+    parametersChanged.set(true);
+}
 
-void updateCoefficients(Coefficients &old, const Coefficients &replacements){
-    *old = *replacements;
+void SimpleEQAudioProcessor::threadCallback(){
+    const RealtimeSafety::ScopedLock sl(designLock);
+    if (designSampleRate <= 0.0 || restoringState.get()){
+        // Not prepared yet: prepareToPlay designs with the real sample rate.
+        // Mid-restore: parametersChanged stays set, and setStateInformation() wakes the thread once it's done.
+        return;
+    }
+    if (parametersChanged.compareAndSetBool(false, true)){
+        designCoefficients(designSampleRate);
+    }
 }
 
-void SimpleEQAudioProcessor::updateLowCutFilters(const ChainSettings &chainSettings){
-    
-    auto lowCutCoefficients  = makeLowCutFilter(chainSettings, getSampleRate());
+void SimpleEQAudioProcessor::designCoefficients(double sampleRate){
+    const RealtimeSafety::ScopedLock sl(designLock);
+    designSampleRate = sampleRate;
+    auto chainSettings = getChainSettings(apvts);
+    auto& coefficients = coefficientHandoff.getWriteBuffer();
+    coefficients = makeChainCoefficients(chainSettings, sampleRate);
+    coefficients.linearPhase = chainSettings.linearPhase;
     
-    auto& leftLowCut = leftChain.get<ChainPositions::LowCut>();
-    auto& rightLowCut = rightChain.get<ChainPositions::LowCut>();
+    // The FIR goes out first so it is already there when the audio thread switches mode.
+    if (chainSettings.linearPhase){
+        LinearPhaseConvolver::designKernel(coefficients, firOrder, kernelHandoff.getWriteBuffer());
+        kernelHandoff.publish();
+    }
+    coefficientHandoff.publish();
     
-    leftChain.setBypassed<ChainPositions::LowCut>(chainSettings.lowCutBypassed);
-    rightChain.setBypassed<ChainPositions::LowCut>(chainSettings.lowCutBypassed);
+    if (chainSettings.linearPhase != reportedLinearPhase){
+        triggerAsyncUpdate();
+    }
+}
 
-    updateCutFilter(leftLowCut, lowCutCoefficients, chainSettings.lowCutSlope);
-    updateCutFilter(rightLowCut, lowCutCoefficients, chainSettings.lowCutSlope);
+void SimpleEQAudioProcessor::handleAsyncUpdate(){
+    const RealtimeSafety::ScopedLock sl(designLock);
+    reportedLinearPhase = getChainSettings(apvts).linearPhase;
+    setLatencySamples(reportedLinearPhase ? linearPhaseConvolver.getLatencySamples() : 0);
 }
 
-void SimpleEQAudioProcessor::updateHighCutFilters(const ChainSettings &chainSettings){
-    auto highCutCoefficients  =  makeHighCutFilter(chainSettings, getSampleRate());
-    
-    auto& leftHighCut = leftChain.get<ChainPositions::HighCut>();
-    auto& rightHighCut = rightChain.get<ChainPositions::HighCut>();
-    
-    leftChain.setBypassed<ChainPositions::HighCut>(chainSettings.highCutBypassed);
-    rightChain.setBypassed<ChainPositions::HighCut>(chainSettings.highCutBypassed);
+void SimpleEQAudioProcessor::pullPendingCoefficients(){
+    if (!coefficientHandoff.pull()){
+        return;
+    }
+    rampTarget = coefficientHandoff.getReadBuffer();
+    if (coefficientsNeedJump){
+        // Nothing is playing through the old coefficients yet, so there is nothing to glide from.
+        coefficientsNeedJump = false;
+        currentCoefficients = rampTarget;
+        coefficientRamp.setCurrentAndTargetValue(1.f);
+        applyCurrentCoefficients();
+        return;
+    }
+    rampStart = currentCoefficients;
+    coefficientRamp.setCurrentAndTargetValue(0.f);
+    coefficientRamp.setTargetValue(1.f);
+}
 
-    updateCutFilter(leftHighCut, highCutCoefficients, chainSettings.highCutSlope);
-    updateCutFilter(rightHighCut, highCutCoefficients, chainSettings.highCutSlope);
+void SimpleEQAudioProcessor::advanceCoefficientRamp(int numSamples){
+    auto position = coefficientRamp.skip(numSamples);
+    if (coefficientRamp.isSmoothing()){
+        interpolateChainCoefficients(rampStart, rampTarget, position, currentCoefficients);
+    } else {
+        currentCoefficients = rampTarget;
+    }
+    applyCurrentCoefficients();
 }
 
-void SimpleEQAudioProcessor::updateFilters(){
-    auto chainSettings = getChainSettings(apvts);
-    updateLowCutFilters(chainSettings);
-    updatePeakFilter(chainSettings);
-    updateHighCutFilters(chainSettings);
+void SimpleEQAudioProcessor::applyCurrentCoefficients(){
+    if (isUsingDoublePrecision()){
+        doubleCascade.setCoefficients(currentCoefficients);
+    } else {
+        floatCascade.setCoefficients(currentCoefficients);
+    }
+    currentIsIdentity = std::none_of(currentCoefficients.active.begin(), currentCoefficients.active.end(),
+                                     [](bool active){return active;});
+}
 
+ChainCoefficients makeChainCoefficients(const ChainSettings& chainSettings, double sampleRate){
+    ChainCoefficients chainCoefficients;
+    chainCoefficients.stages.fill({1.0, 0.0, 0.0, 0.0, 0.0});
+    chainCoefficients.active.fill(false);
+    
+    // Designed in double whatever the processing precision, so the ramp and the
+    // linear-phase kernel start from the most accurate coefficients.
+    auto copyStage = [&chainCoefficients](int stage, const juce::dsp::IIR::Coefficients<double>::Ptr& coefficients){
+        jassert(coefficients->coefficients.size() == 5);
+        auto* raw = coefficients->getRawCoefficients();
+        std::copy(raw, raw + 5, chainCoefficients.stages[stage].begin());
+        chainCoefficients.active[stage] = true;
+    };
     
+    if (isLowCutEngaged(chainSettings)){
+        auto lowCutCoefficients = makeLowCutFilter<double>(chainSettings, sampleRate);
+        for (int i = 0; i <= chainSettings.lowCutSlope; ++i){
+            copyStage(LowCutFirstStage + i, lowCutCoefficients[i]);
+        }
+    }
+    if (isPeakEngaged(chainSettings)){
+        copyStage(PeakStage, makePeakFilter<double>(chainSettings, sampleRate));
+    }
+    if (isHighCutEngaged(chainSettings)){
+        auto highCutCoefficients = makeHighCutFilter<double>(chainSettings, sampleRate);
+        for (int i = 0; i <= chainSettings.highCutSlope; ++i){
+            copyStage(HighCutFirstStage + i, highCutCoefficients[i]);
+        }
+    }
+    return chainCoefficients;
+}
+
+void interpolateChainCoefficients(const ChainCoefficients& start,
+                                  const ChainCoefficients& target,
+                                  float position,
+                                  ChainCoefficients& result){
+    for (int stage = 0; stage < NumChainStages; ++stage){
+        const auto& from = start.stages[stage];
+        const auto& to = target.stages[stage];
+        for (size_t i = 0; i < from.size(); ++i){
+            result.stages[stage][i] = from[i] + (to[i] - from[i]) * (double) position;
+        }
+        result.active[stage] = start.active[stage] || target.active[stage];
+    }
 }
+
 ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts){
     ChainSettings settings;
     settings.lowCutFreq = apvts.getRawParameterValue("LowCut Freq") -> load();
@@ -283,11 +534,25 @@ ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts){
     settings.lowCutBypassed = apvts.getRawParameterValue("LowCut Bypassed") -> load() > 0.5f;
     settings.peakBypassed = apvts.getRawParameterValue("Peak Bypassed") -> load() > 0.5f;
     settings.highCutBypassed = apvts.getRawParameterValue("HighCut Bypassed") -> load() > 0.5f;
+    settings.analogMatched = apvts.getRawParameterValue("Analog Matched") -> load() > 0.5f;
+    settings.linearPhase = apvts.getRawParameterValue("Linear Phase") -> load() > 0.5f;
 //    settings.analyzerEnabled = apvts.getRawParameterValue("Analyzer Enabled") -> load() > 0.5f;
 
     return settings;
 }
 
+bool isLowCutEngaged(const ChainSettings& chainSettings){
+    return !chainSettings.lowCutBypassed && chainSettings.lowCutFreq > 20.f;
+}
+
+bool isPeakEngaged(const ChainSettings& chainSettings){
+    return !chainSettings.peakBypassed && chainSettings.peakGainInDecibels != 0.f;
+}
+
+bool isHighCutEngaged(const ChainSettings& chainSettings){
+    return !chainSettings.highCutBypassed && chainSettings.highCutFreq < 20000.f;
+}
+
 juce::AudioProcessorValueTreeState::ParameterLayout SimpleEQAudioProcessor::createParameterLayout(){
     juce::AudioProcessorValueTreeState::ParameterLayout layout;
     layout.add(std::make_unique<juce::AudioParameterFloat>("LowCut Freq",
@@ -331,6 +596,8 @@ juce::AudioProcessorValueTreeState::ParameterLayout SimpleEQAudioProcessor::crea
     layout.add(std::make_unique<juce::AudioParameterBool>("Peak Bypassed", "Peak Bypassed", false));
     layout.add(std::make_unique<juce::AudioParameterBool>("HighCut Bypassed", "HighCut Bypassed", false));
     layout.add(std::make_unique<juce::AudioParameterBool>("Analyzer Enabled", "Analyzer Enabled", true));
+    layout.add(std::make_unique<juce::AudioParameterBool>("Analog Matched", "Analog Matched", false));
+    layout.add(std::make_unique<juce::AudioParameterBool>("Linear Phase", "Linear Phase", false));
 
 
     return layout;
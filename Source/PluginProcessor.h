@@ -9,6 +9,13 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "FilterDesignThread.hpp"
+#include "MatchedFilterDesign.hpp"
+#include "LinearPhaseConvolver.hpp"
+#include "ChainCoefficients.hpp"
+#include "BiquadCascade.hpp"
+#include "RealtimeSafety.hpp"
+#include "PluginState.hpp"
 
 enum Channel {
     Right,
@@ -63,50 +70,140 @@ private:
     
 };
 
-template<typename BlockType>
+/*
+ Lock-free single-writer / single-reader handoff: the writer fills
+ getWriteBuffer() and publishes it, the reader pulls the most recently
+ published buffer. Neither side ever waits on the other, and intermediate
+ publications the reader never saw are simply dropped.
+ */
+template<typename T>
+struct TripleBuffer{
+    T& getWriteBuffer() {return buffers[writeIndex];}
+    
+    void publish(){
+        writeIndex = shared.exchange(writeIndex | newDataFlag) & indexMask;
+    }
+    
+    bool pull(){
+        if ((shared.get() & newDataFlag) == 0){
+            return false;
+        }
+        readIndex = shared.exchange(readIndex) & indexMask;
+        return true;
+    }
+    
+    const T& getReadBuffer() const {return buffers[readIndex];}
+private:
+    static constexpr int indexMask = 3;
+    static constexpr int newDataFlag = 4;
+    std::array<T, 3> buffers;
+    juce::Atomic<int> shared {1};
+    int writeIndex = 0, readIndex = 2;
+};
+
+/*
+ Captures one channel (or a downmix) for the analyzer in a lock-free
+ single-producer / single-consumer ring of raw floats. The audio thread
+ copies each block in bulk, whatever its size, and never allocates. If the
+ reader falls behind, whatever doesn't fit is dropped and counted in
+ getNumOverruns().
+
+ Readers subscribe with addConsumer(); with nobody subscribed, update() costs
+ one atomic load and copies nothing.
+ */
 struct SingleChannelSampleFifo{
-    SingleChannelSampleFifo(Channel ch): channelToUse(ch){
+    // Pass a channel index to tap that channel, or downmixSource to tap the average of all channels.
+    static constexpr int downmixSource = -1;
+    
+    SingleChannelSampleFifo(Channel ch): source(ch){
         prepared.set(false);
     }
-    void update (const BlockType& buffer){
+    
+    // Takes float or double buffers; the analyzer itself always works in float.
+    template<typename SampleType>
+    void update (const juce::AudioBuffer<SampleType>& buffer){
+        if (numConsumers.get() == 0){
+            return;
+        }
         jassert(prepared.get());
-        jassert(buffer.getNumChannels() > channelToUse);
-        auto* channelPtr = buffer.getReadPointer(channelToUse);
-        for (int i =0; i<buffer.getNumSamples(); ++i){
-            pushNextSampleIntoFifo(channelPtr[i]);
+        const auto channelToUse = source.get();
+        const auto numChannels = buffer.getNumChannels();
+        const auto numSamples = buffer.getNumSamples();
+        const auto tapChannel = juce::isPositiveAndBelow(channelToUse, numChannels);
+        if constexpr (std::is_same_v<SampleType, float>){
+            if (tapChannel){
+                write(buffer.getReadPointer(channelToUse), numSamples);
+                return;
+            }
+        }
+        // Conversions and downmixes go through a fixed scratch block, so any host block size works.
+        for (int start = 0; start < numSamples; start += scratchSize){
+            const auto numToWrite = juce::jmin(scratchSize, numSamples - start);
+            if (tapChannel){
+                auto* channelPtr = buffer.getReadPointer(channelToUse, start);
+                for (int i = 0; i < numToWrite; ++i){
+                    scratch[(size_t) i] = static_cast<float>(channelPtr[i]);
+                }
+            } else {
+                juce::FloatVectorOperations::clear(scratch.data(), numToWrite);
+                for (int ch = 0; ch < numChannels; ++ch){
+                    auto* channelPtr = buffer.getReadPointer(ch, start);
+                    for (int i = 0; i < numToWrite; ++i){
+                        scratch[(size_t) i] += static_cast<float>(channelPtr[i]);
+                    }
+                }
+                juce::FloatVectorOperations::multiply(scratch.data(), 1.f / (float) juce::jmax(1, numChannels), numToWrite);
+            }
+            write(scratch.data(), numToWrite);
         }
     }
+    
     void prepare(int bufferSize){
         prepared.set(false);
         size.set(bufferSize);
-        bufferToFill.setSize(1, bufferSize, false, true, true);
-        audioBufferFifo.prepare(1, bufferSize);
-        fifoIndex=0;
         prepared.set(true);
     }
-    int getNumCompleteBuffersAvailable() const {return audioBufferFifo.getNumAvailableForReading();}
+    
+    void setSource(int channelOrDownmix) {source.set(channelOrDownmix);}
+    int getSource() const {return source.get();}
+    
+    void addConsumer() {numConsumers += 1;}
+    void removeConsumer() {numConsumers -= 1;}
+    
+    int getNumSamplesAvailable() const {return ring.getNumReady();}
+    // Copies up to maxSamples of the oldest captured samples out; returns how many it copied.
+    int pull(float* destination, int maxSamples){
+        const auto scope = ring.read(maxSamples);
+        std::copy_n(ringData.begin() + scope.startIndex1, scope.blockSize1, destination);
+        std::copy_n(ringData.begin() + scope.startIndex2, scope.blockSize2, destination + scope.blockSize1);
+        return scope.blockSize1 + scope.blockSize2;
+    }
+    int getNumOverruns() const {return overruns.get();}
+    
     bool isPrepared() const {return prepared.get();}
     int getSize() const { return size.get();}
-    
-    bool getAudioBuffer(BlockType& buf ){return audioBufferFifo.pull(buf);}
 private:
-    Channel channelToUse;
-    int fifoIndex = 0;
-    Fifo<BlockType> audioBufferFifo;
-    BlockType bufferToFill;
+    // About 0.7 s at 44.1 kHz: far more than the analyzer lets pile up between two reads.
+    static constexpr int ringCapacity = 1 << 15;
+    static constexpr int scratchSize = 512;
+    
+    juce::Atomic<int> source;
+    std::vector<float> ringData = std::vector<float>(ringCapacity, 0.f);
+    juce::AbstractFifo ring {ringCapacity};
+    std::vector<float> scratch = std::vector<float>(scratchSize, 0.f);
+    juce::Atomic<int> overruns {0};
+    juce::Atomic<int> numConsumers {0};
     juce::Atomic<bool> prepared = false;
     juce::Atomic<int> size = 0;
     
-    void pushNextSampleIntoFifo(float sample){
-        if (fifoIndex == bufferToFill.getNumSamples()){
-            auto ok = audioBufferFifo.push(bufferToFill);
-            juce::ignoreUnused(ok);
-            fifoIndex=0;
+    void write(const float* samples, int numSamples){
+        const auto scope = ring.write(numSamples);
+        std::copy_n(samples, scope.blockSize1, ringData.begin() + scope.startIndex1);
+        std::copy_n(samples + scope.blockSize1, scope.blockSize2, ringData.begin() + scope.startIndex2);
+        if (scope.blockSize1 + scope.blockSize2 < numSamples){
+            overruns += 1;
         }
-        bufferToFill.setSample(0, fifoIndex, sample);
-        ++fifoIndex;
     }
-    
 };
 
 enum Slope {
@@ -121,12 +218,27 @@ struct ChainSettings {
     float lowCutFreq {0}, highCutFreq {0};
     Slope lowCutSlope {Slope::Slope_12}, highCutSlope {Slope::Slope_12};
     bool lowCutBypassed{false}, peakBypassed{false}, highCutBypassed{false};
+    bool analogMatched{false};
+    bool linearPhase{false};
 };
 
 ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts);
-using Filter = juce::dsp::IIR::Filter<float>;
-using CutFilter = juce::dsp::ProcessorChain<Filter, Filter, Filter, Filter>;
-using MonoChain = juce::dsp::ProcessorChain<CutFilter, Filter, CutFilter>;
+
+// A band left at its neutral setting (0 dB peak, cuts parked at the ends of the 20 Hz - 20 kHz range)
+// is treated as switched off, so a flat EQ costs nothing.
+bool isLowCutEngaged(const ChainSettings& chainSettings);
+bool isPeakEngaged(const ChainSettings& chainSettings);
+bool isHighCutEngaged(const ChainSettings& chainSettings);
+template<typename SampleType>
+using FilterT = juce::dsp::IIR::Filter<SampleType>;
+template<typename SampleType>
+using CutFilterT = juce::dsp::ProcessorChain<FilterT<SampleType>, FilterT<SampleType>, FilterT<SampleType>, FilterT<SampleType>>;
+template<typename SampleType>
+using ChainT = juce::dsp::ProcessorChain<CutFilterT<SampleType>, FilterT<SampleType>, CutFilterT<SampleType>>;
+
+using Filter = FilterT<float>;
+using CutFilter = CutFilterT<float>;
+using MonoChain = ChainT<float>;
 
 enum ChainPositions {
     LowCut,
@@ -134,59 +246,64 @@ enum ChainPositions {
     HighCut
 };
 
-using Coefficients = Filter::CoefficientsPtr;
-void updateCoefficients(Coefficients& old, const Coefficients& replacements);
-
-Coefficients makePeakFilter(const ChainSettings& chainSettings,double sampleRate);
+template<typename FloatType = float>
+typename juce::dsp::IIR::Coefficients<FloatType>::Ptr makePeakFilter(const ChainSettings& chainSettings, double sampleRate){
+    if (chainSettings.analogMatched){
+        return makeMatchedPeakFilter<FloatType>(sampleRate,
+                                                limitToBelowNyquist(chainSettings.peakFreq, sampleRate),
+                                                chainSettings.peakQuality,
+                                                juce::Decibels::decibelsToGain(chainSettings.peakGainInDecibels));
+    }
+    return juce::dsp::IIR::Coefficients<FloatType>::makePeakFilter(sampleRate,
+                                                                   limitToBelowNyquist(chainSettings.peakFreq, sampleRate),
+                                                                   chainSettings.peakQuality,
+                                                                   juce::Decibels::decibelsToGain((FloatType) chainSettings.peakGainInDecibels));
+}
 
 
-template<int Index, typename ChainType, typename CoefficientType>
-void update(ChainType& chain, const CoefficientType& coefficients){
-    updateCoefficients(chain.template get<Index>().coefficients, coefficients[Index]);
-    chain.template setBypassed<Index>(false);
+template<typename FloatType = float>
+auto makeLowCutFilter(const ChainSettings& chainSettings, double sampleRate){
+    if (chainSettings.analogMatched){
+        return designMatchedButterworthHighPass<FloatType>(limitToBelowNyquist(chainSettings.lowCutFreq, sampleRate),
+                                                sampleRate,
+                                                2 * (chainSettings.lowCutSlope + 1));
+    }
+    return juce::dsp::FilterDesign<FloatType>::designIIRHighpassHighOrderButterworthMethod(limitToBelowNyquist(chainSettings.lowCutFreq, sampleRate),
+                                                                                           sampleRate,
+                                                                                           2 * (chainSettings.lowCutSlope + 1));
 }
 
-template<typename ChainType, typename CoefficientType>
-void updateCutFilter(ChainType& leftLowCut,
-                     const CoefficientType& cutCoefficients,
-                     const Slope& lowCutSlope){
-    
-    
-    leftLowCut.template setBypassed<0>(true);
-    leftLowCut.template setBypassed<1>(true);
-    leftLowCut.template setBypassed<2>(true);
-    leftLowCut.template setBypassed<3>(true);
-    
-    switch (lowCutSlope) {
-        case Slope_48:
-            update<3>(leftLowCut, cutCoefficients);
-        case Slope_36:
-            update<2>(leftLowCut, cutCoefficients);
-        case Slope_24:
-            update<1>(leftLowCut, cutCoefficients);
-        case Slope_12:
-            update<0>(leftLowCut, cutCoefficients);
-            
-        default:
-            break;
+template<typename FloatType = float>
+auto makeHighCutFilter(const ChainSettings& chainSettings, double sampleRate){
+    if (chainSettings.analogMatched){
+        return designMatchedButterworthLowPass<FloatType>(limitToBelowNyquist(chainSettings.highCutFreq, sampleRate),
+                                               sampleRate,
+                                               2 * (chainSettings.highCutSlope + 1));
     }
-};
-
-inline auto makeLowCutFilter(const ChainSettings& chainSettings, double sampleRate){
-    return juce::dsp::FilterDesign<float>::designIIRHighpassHighOrderButterworthMethod(chainSettings.lowCutFreq,
-                                                                                       sampleRate,
-                                                                                       2 * (chainSettings.lowCutSlope + 1));
+    return juce::dsp::FilterDesign<FloatType>::designIIRLowpassHighOrderButterworthMethod(limitToBelowNyquist(chainSettings.highCutFreq, sampleRate),
+                                                                                          sampleRate,
+                                                                                          2 * (chainSettings.highCutSlope + 1));
 }
 
-inline auto makeHighCutFilter(const ChainSettings& chainSettings, double sampleRate){
-    return juce::dsp::FilterDesign<float>::designIIRLowpassHighOrderButterworthMethod(chainSettings.highCutFreq,
-                                                                                       sampleRate,
-                                                                                       2 * (chainSettings.highCutSlope + 1));
-}
+ChainCoefficients makeChainCoefficients(const ChainSettings& chainSettings, double sampleRate);
+
+/*
+ Linear interpolation in the coefficient domain. Stages that are off on either
+ side take part as identity sections. The set of stable (a1, a2) pairs is
+ convex, so every intermediate filter between two stable ones is stable too.
+ */
+void interpolateChainCoefficients(const ChainCoefficients& start,
+                                  const ChainCoefficients& target,
+                                  float position,
+                                  ChainCoefficients& result);
+
 //==============================================================================
 /**
 */
-class SimpleEQAudioProcessor  : public juce::AudioProcessor
+class SimpleEQAudioProcessor  : public juce::AudioProcessor,
+                                juce::AudioProcessorParameter::Listener,
+                                ClientThread::Client,
+                                juce::AsyncUpdater
 {
 public:
     //==============================================================================
@@ -202,6 +319,8 @@ public:
    #endif
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override {return true;}
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -225,23 +344,81 @@ public:
     //==============================================================================
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
+    void parameterValueChanged (int parameterIndex, float newValue) override;
+    void parameterGestureChanged (int parameterIndex, bool gestureIsStarting) override {};
+    
+    // On the FilterDesignThread: redesigns the coefficients if a parameter has moved.
+    void threadCallback() override;
+    void handleAsyncUpdate() override;
+    
     static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
     juce::AudioProcessorValueTreeState apvts {*this, nullptr, "Parameters", createParameterLayout()};
-    using BlockType = juce::AudioBuffer<float>;
-    SingleChannelSampleFifo<BlockType> leftChannelFifo { Channel::Left};
-    SingleChannelSampleFifo<BlockType> rightChannelFifo { Channel::Right};
+    SingleChannelSampleFifo leftChannelFifo { Channel::Left};
+    SingleChannelSampleFifo rightChannelFifo { Channel::Right};
+    
+    // Analyzer overruns, plus the deadline histogram and the allocation and lock
+    // traps in the benchmark and batch renderer builds (SIMPLE_EQ_REALTIME_CHECKS).
+    RealtimeSafety::Report getRealtimeReport() const;
+    void resetRealtimeStats() {realtimeStats.reset();}
 private:
+    RealtimeSafety::Stats realtimeStats;
     
-    MonoChain leftChain, rightChain;
+    // Only the engine matching isUsingDoublePrecision() is prepared.
+    MultiChannelCascade<float> floatCascade;
+    MultiChannelCascade<double> doubleCascade;
     
-    void updatePeakFilter(const ChainSettings& chainSettings);
+    // Coefficients are designed on the shared FilterDesignThread (or in prepareToPlay)
+    // and handed to the audio thread through coefficientHandoff.
+    juce::Atomic<bool> parametersChanged {true};
+    // Holds the design back while setStateInformation() moves the parameters one by one.
+    juce::Atomic<bool> restoringState {false};
+    juce::CriticalSection designLock;
+    double designSampleRate = 0.0;
+    TripleBuffer<ChainCoefficients> coefficientHandoff;
+    TripleBuffer<LinearPhaseKernel> kernelHandoff;
+    int firOrder = 0;
+    bool reportedLinearPhase = false;
+    juce::SharedResourcePointer<FilterDesignThread> designThread;
     
+    void designCoefficients(double sampleRate);
     
-    void updateLowCutFilters(const ChainSettings& chainSettings);
-    void updateHighCutFilters(const ChainSettings& chainSettings);
-
-    void updateFilters();
-    juce::dsp::Oscillator<float> osc;
+    // Audio thread only.
+    static constexpr double coefficientRampSeconds = 0.02;
+    // Coefficients glide towards each new design, updated every controlRate samples.
+    static constexpr int controlRate = 32;
+    juce::SmoothedValue<float> coefficientRamp;
+    ChainCoefficients rampStart, rampTarget, currentCoefficients;
+    bool coefficientsNeedJump = true;
+    bool currentIsIdentity = true;
+    bool linearPhaseActive = false;
+    LinearPhaseConvolver linearPhaseConvolver;
+    std::atomic<float>* analyzerEnabled = nullptr;
+    // The convolver is float-only; double buffers go through here.
+    juce::AudioBuffer<float> linearPhaseScratch;
+    // Switching between minimum and linear phase runs both paths and crossfades
+    // over one partition; the incoming path's copy of the input goes through here.
+    static constexpr int modeFadeLength = LinearPhaseConvolver::partitionSize;
+    int modeFadeRemaining = 0;
+    juce::AudioBuffer<float> floatModeFadeScratch;
+    juce::AudioBuffer<double> doubleModeFadeScratch;
+    
+    void pullPendingCoefficients();
+    void advanceCoefficientRamp(int numSamples);
+    void applyCurrentCoefficients();
+    template<typename SampleType>
+    void processSamples(juce::AudioBuffer<SampleType>& buffer);
+    template<typename SampleType>
+    void processMode(juce::dsp::AudioBlock<SampleType>& block, bool linearPhase);
+    template<typename SampleType>
+    void processMinimumPhase(juce::dsp::AudioBlock<SampleType>& block);
+    template<typename SampleType>
+    void crossfadeModes(juce::dsp::AudioBlock<SampleType>& block, juce::dsp::AudioBlock<SampleType>& incoming);
+    void processLinearPhase(juce::dsp::AudioBlock<float>& block);
+    void processLinearPhase(juce::dsp::AudioBlock<double>& block);
+    juce::AudioBuffer<float>& getModeFadeScratch(float) {return floatModeFadeScratch;}
+    juce::AudioBuffer<double>& getModeFadeScratch(double) {return doubleModeFadeScratch;}
+    void processCascades(juce::dsp::AudioBlock<float>& block) {floatCascade.process(block);}
+    void processCascades(juce::dsp::AudioBlock<double>& block) {doubleCascade.process(block);}
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SimpleEQAudioProcessor)
 };
@@ -0,0 +1,109 @@
+//
+//  PluginState.cpp
+//  Simple EQ
+//
+//  Copyright © 2022 Hsian. All rights reserved.
+//
+
+#include "PluginState.hpp"
+
+namespace {
+    constexpr int headerSize = 8;
+    constexpr int valueSize = 4;
+
+    const juce::AudioProcessorParameterWithID* withID(const juce::AudioProcessorParameter* parameter){
+        auto* result = dynamic_cast<const juce::AudioProcessorParameterWithID*>(parameter);
+        jassert(result != nullptr);
+        return result;
+    }
+
+    float readValue(const char* bytes){
+        const auto valueBits = (juce::uint32) juce::ByteOrder::littleEndianInt(bytes);
+        float value;
+        std::memcpy(&value, &valueBits, sizeof(value));
+        return value;
+    }
+
+    void restoreValue(juce::AudioProcessorParameter& parameter, float value){
+        if (!std::isfinite(value)){
+            return;
+        }
+        value = juce::jlimit(0.f, 1.f, value);
+        if (parameter.getValue() != value){
+            parameter.setValueNotifyingHost(value);
+        }
+    }
+
+    // Records of {uint8 ID length, UTF-8 ID, float32 value}.
+    int getNamedRecordSize(const char* record){
+        return 1 + (int) (juce::uint8) *record + valueSize;
+    }
+
+    bool hasNamedRecords(const char* records, int sizeInBytes, int count){
+        const auto* end = records + sizeInBytes;
+        for (int i = 0; i < count; ++i){
+            if (records >= end || end - records < getNamedRecordSize(records)){
+                return false;
+            }
+            records += getNamedRecordSize(records);
+        }
+        return true;
+    }
+
+    bool readNamedRecords(const char* records, int sizeInBytes, int count,
+                          const juce::Array<juce::AudioProcessorParameter*>& parameters){
+        // A truncated state is left alone rather than half applied.
+        if (!hasNamedRecords(records, sizeInBytes, count)){
+            return false;
+        }
+        for (int i = 0; i < count; ++i){
+            const auto idLength = (size_t) (juce::uint8) *records;
+            const auto* id = records + 1;
+            for (auto* parameter: parameters){
+                auto* parameterWithID = withID(parameter);
+                if (parameterWithID != nullptr
+                    && parameterWithID->paramID.getNumBytesAsUTF8() == idLength
+                    && std::memcmp(parameterWithID->paramID.toRawUTF8(), id, idLength) == 0){
+                    restoreValue(*parameter, readValue(id + idLength));
+                    break;
+                }
+            }
+            records += getNamedRecordSize(records);
+        }
+        return true;
+    }
+}
+
+namespace PluginState {
+    void write(const juce::Array<juce::AudioProcessorParameter*>& parameters, juce::MemoryBlock& destData){
+        juce::MemoryOutputStream stream(destData, false);
+        stream.writeInt((int) magic);
+        stream.writeShort((short) currentVersion);
+        stream.writeShort((short) parameters.size());
+        for (auto* parameter: parameters){
+            auto* parameterWithID = withID(parameter);
+            const auto id = parameterWithID != nullptr ? parameterWithID->paramID : juce::String();
+            jassert(id.getNumBytesAsUTF8() <= 255);
+            const auto idLength = juce::jmin(id.getNumBytesAsUTF8(), (size_t) 255);
+            stream.writeByte((char) idLength);
+            stream.write(id.toRawUTF8(), idLength);
+            stream.writeFloat(parameter->getValue());
+        }
+    }
+
+    bool read(const void* data, int sizeInBytes, const juce::Array<juce::AudioProcessorParameter*>& parameters){
+        if (data == nullptr || sizeInBytes < headerSize){
+            return false;
+        }
+        auto* bytes = static_cast<const char*>(data);
+        if ((juce::uint32) juce::ByteOrder::littleEndianInt(bytes) != magic){
+            return false;
+        }
+        if (juce::ByteOrder::littleEndianShort(bytes + 4) != currentVersion){
+            // Saved by a newer build: not guessed at.
+            return false;
+        }
+        const auto count = (int) juce::ByteOrder::littleEndianShort(bytes + 6);
+        return readNamedRecords(bytes + headerSize, sizeInBytes - headerSize, count, parameters);
+    }
+}
@@ -0,0 +1,33 @@
+//
+//  PluginState.hpp
+//  Simple EQ
+//
+//  Copyright © 2022 Hsian. All rights reserved.
+//
+
+#ifndef PluginState_hpp
+#define PluginState_hpp
+#include <JuceHeader.h>
+
+/*
+ Compact binary plugin state, used by get/setStateInformation instead of the
+ apvts ValueTree stream:
+
+     uint32 magic 'SEQS', uint16 version, uint16 count,
+     count x {uint8 ID length, parameter ID in UTF-8, float32 normalised value}
+
+ all little-endian. Restoring writes the values straight into the parameters,
+ skipping any that are already at the stored value.
+ */
+namespace PluginState {
+    constexpr juce::uint32 magic = 0x53514553; // "SEQS"
+    constexpr juce::uint16 currentVersion = 1;
+
+    void write(const juce::Array<juce::AudioProcessorParameter*>& parameters, juce::MemoryBlock& destData);
+    // False, with nothing applied, unless the data is a complete state of this
+    // version: a legacy ValueTree stream, a truncated state and one saved by a
+    // newer build are all left to the caller. Parameters missing from the state
+    // keep their current values.
+    bool read(const void* data, int sizeInBytes, const juce::Array<juce::AudioProcessorParameter*>& parameters);
+}
+#endif /* PluginState_hpp */
@@ -0,0 +1,183 @@
+//
+//  RealtimeSafety.cpp
+//  Simple EQ
+//
+//  Copyright © 2022 Hsian. All rights reserved.
+//
+
+#include "RealtimeSafety.hpp"
+
+namespace RealtimeSafety {
+    juce::uint64 Report::getNumMissedDeadlines() const {
+        // Everything in the buckets above a load of 1.
+        juce::uint64 numMissed = 0;
+        for (int bucket = numLoadBuckets - 2; bucket < numLoadBuckets; ++bucket){
+            numMissed += loadHistogram[(size_t) bucket];
+        }
+        return numMissed;
+    }
+
+    juce::String Report::toString() const {
+        juce::String text;
+        text << "blocks: " << (juce::int64) numBlocks << juce::newLine
+             << "allocations inside processBlock: " << (juce::int64) numAllocations << juce::newLine
+             << "locks inside processBlock: " << (juce::int64) numLocks << juce::newLine
+             << "missed deadlines: " << (juce::int64) getNumMissedDeadlines() << juce::newLine
+             << "worst load: " << juce::String(worstLoad * 100.0, 1) << "% of the block duration" << juce::newLine
+             << "load histogram:" << juce::newLine;
+        for (int bucket = 0; bucket < numLoadBuckets; ++bucket){
+            const auto limit = bucket < (int) loadBucketLimits.size() ? loadBucketLimits[(size_t) bucket] : loadBucketLimits.back();
+            text << (bucket < (int) loadBucketLimits.size() ? "  < " : "  >= ") << juce::String(limit * 100.0) << "%: "
+                 << (juce::int64) loadHistogram[(size_t) bucket] << juce::newLine;
+        }
+        text << "analyzer FIFO overruns: left " << leftAnalyzerOverruns << ", right " << rightAnalyzerOverruns << juce::newLine;
+        return text;
+    }
+
+    void Stats::addBlock(double load){
+        const auto bucket = std::upper_bound(loadBucketLimits.begin(), loadBucketLimits.end(), load) - loadBucketLimits.begin();
+        loadHistogram[(size_t) bucket].fetch_add(1, std::memory_order_relaxed);
+        numBlocks.fetch_add(1, std::memory_order_relaxed);
+        if (load > worstLoad.load(std::memory_order_relaxed)){
+            worstLoad.store(load, std::memory_order_relaxed);
+        }
+    }
+
+    void Stats::reset(){
+        numBlocks = 0;
+        numAllocations = 0;
+        numLocks = 0;
+        for (auto& count: loadHistogram){
+            count = 0;
+        }
+        worstLoad = 0.0;
+    }
+
+    Report Stats::getReport() const {
+        Report report;
+        report.numBlocks = numBlocks.load();
+        report.numAllocations = numAllocations.load();
+        report.numLocks = numLocks.load();
+        for (int bucket = 0; bucket < numLoadBuckets; ++bucket){
+            report.loadHistogram[(size_t) bucket] = loadHistogram[(size_t) bucket].load();
+        }
+        report.worstLoad = worstLoad.load();
+        return report;
+    }
+}
+
+#if SIMPLE_EQ_REALTIME_CHECKS
+#if JUCE_WINDOWS
+ #include <malloc.h>
+#endif
+
+namespace {
+    // Fine in an executable: a thread_local pointer lives in the static TLS block
+    // and reading it from operator new never allocates.
+    thread_local RealtimeSafety::Stats* currentStats = nullptr;
+
+    // Cleared while counting, so whatever the assertion allocates isn't trapped again.
+    void noteViolation(std::atomic<juce::uint64> RealtimeSafety::Stats::* counter){
+        if (auto* stats = currentStats){
+            currentStats = nullptr;
+            (stats->*counter).fetch_add(1, std::memory_order_relaxed);
+            jassertfalse;
+            currentStats = stats;
+        }
+    }
+
+    void noteAllocation(){
+        noteViolation(&RealtimeSafety::Stats::numAllocations);
+    }
+
+    void* allocateAligned(std::size_t alignment, std::size_t size){
+       #if JUCE_WINDOWS
+        return _aligned_malloc(size, alignment);
+       #else
+        void* p = nullptr;
+        return posix_memalign(&p, juce::jmax(alignment, sizeof(void*)), size) == 0 ? p : nullptr;
+       #endif
+    }
+
+    void releaseAligned(void* p){
+       #if JUCE_WINDOWS
+        _aligned_free(p);
+       #else
+        std::free(p);
+       #endif
+    }
+}
+
+namespace RealtimeSafety {
+    ScopedProcessBlock::ScopedProcessBlock(Stats& statsToUse, int numSamples, double sampleRate)
+        : stats(statsToUse),
+          previous(currentStats),
+          blockSeconds(sampleRate > 0.0 ? numSamples / sampleRate : 0.0),
+          startTicks(juce::Time::getHighResolutionTicks()){
+        currentStats = &stats;
+    }
+
+    ScopedProcessBlock::~ScopedProcessBlock(){
+        currentStats = previous;
+        if (blockSeconds > 0.0){
+            const auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+            stats.addBlock(elapsed / blockSeconds);
+        }
+    }
+
+    ScopedLock::ScopedLock(const juce::CriticalSection& lockToUse) : lock(lockToUse){
+        noteViolation(&Stats::numLocks);
+        lock.enter();
+    }
+}
+
+void* operator new(std::size_t size){
+    noteAllocation();
+    if (auto* p = std::malloc(size > 0 ? size : 1)){
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size){
+    return operator new(size);
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    noteAllocation();
+    return std::malloc(size > 0 ? size : 1);
+}
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+void operator delete(void* p) noexcept {std::free(p);}
+void operator delete[](void* p) noexcept {std::free(p);}
+void operator delete(void* p, std::size_t) noexcept {std::free(p);}
+void operator delete[](void* p, std::size_t) noexcept {std::free(p);}
+void operator delete(void* p, const std::nothrow_t&) noexcept {std::free(p);}
+void operator delete[](void* p, const std::nothrow_t&) noexcept {std::free(p);}
+
+#if __cpp_aligned_new
+void* operator new(std::size_t size, std::align_val_t alignment){
+    noteAllocation();
+    if (auto* p = allocateAligned((std::size_t) alignment, size > 0 ? size : 1)){
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size, std::align_val_t alignment){
+    return operator new(size, alignment);
+}
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    noteAllocation();
+    return allocateAligned((std::size_t) alignment, size > 0 ? size : 1);
+}
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t& tag) noexcept {
+    return operator new(size, alignment, tag);
+}
+void operator delete(void* p, std::align_val_t) noexcept {releaseAligned(p);}
+void operator delete[](void* p, std::align_val_t) noexcept {releaseAligned(p);}
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {releaseAligned(p);}
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept {releaseAligned(p);}
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept {releaseAligned(p);}
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept {releaseAligned(p);}
+#endif
+#endif
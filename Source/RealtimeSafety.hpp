@@ -0,0 +1,90 @@
+//
+//  RealtimeSafety.hpp
+//  Simple EQ
+//
+//  Copyright © 2022 Hsian. All rights reserved.
+//
+
+#ifndef RealtimeSafety_hpp
+#define RealtimeSafety_hpp
+#include <JuceHeader.h>
+
+/*
+ Instrumentation for dropouts, compiled in with SIMPLE_EQ_REALTIME_CHECKS=1.
+ Only the benchmark and the batch renderer set it: they are executables, so
+ replacing operator new there affects nobody else's allocations.
+
+ While a ScopedProcessBlock is alive on a thread, every operator new and every
+ RealtimeSafety::ScopedLock taken on that thread is counted (and asserts in
+ debug builds), and the block's wall time is added to a histogram relative to
+ its deadline. Memory from malloc (HeapBlock, AudioBuffer) and locks taken
+ without RealtimeSafety::ScopedLock are not seen.
+
+ Without the flag ScopedProcessBlock is empty, ScopedLock is juce::ScopedLock
+ and nothing is replaced.
+ */
+#ifndef SIMPLE_EQ_REALTIME_CHECKS
+ #define SIMPLE_EQ_REALTIME_CHECKS 0
+#endif
+#if SIMPLE_EQ_REALTIME_CHECKS && ! SIMPLE_EQ_HEADLESS
+ #error "SIMPLE_EQ_REALTIME_CHECKS replaces operator new, which a plugin must not do to its host"
+#endif
+
+namespace RealtimeSafety {
+    constexpr bool isEnabled = SIMPLE_EQ_REALTIME_CHECKS != 0;
+
+    // Upper limits of the load buckets: processBlock wall time over the block's duration.
+    // Everything above the last limit lands in one more bucket.
+    constexpr std::array<double, 8> loadBucketLimits {0.01, 0.02, 0.05, 0.1, 0.2, 0.5, 1.0, 2.0};
+    constexpr int numLoadBuckets = (int) loadBucketLimits.size() + 1;
+
+    struct Report {
+        juce::uint64 numBlocks = 0, numAllocations = 0, numLocks = 0;
+        std::array<juce::uint64, numLoadBuckets> loadHistogram {};
+        double worstLoad = 0.0;
+        int leftAnalyzerOverruns = 0, rightAnalyzerOverruns = 0;
+
+        juce::uint64 getNumMissedDeadlines() const;
+        juce::String toString() const;
+    };
+
+    // Written by the audio thread, read from anywhere.
+    struct Stats {
+        void addBlock(double load);
+        void reset();
+        Report getReport() const;
+
+        std::atomic<juce::uint64> numBlocks {0}, numAllocations {0}, numLocks {0};
+    private:
+        std::array<std::atomic<juce::uint64>, numLoadBuckets> loadHistogram {};
+        std::atomic<double> worstLoad {0.0};
+    };
+
+   #if SIMPLE_EQ_REALTIME_CHECKS
+    struct ScopedProcessBlock {
+        ScopedProcessBlock(Stats& stats, int numSamples, double sampleRate);
+        ~ScopedProcessBlock();
+    private:
+        Stats& stats;
+        Stats* previous;
+        double blockSeconds;
+        juce::int64 startTicks;
+        JUCE_DECLARE_NON_COPYABLE(ScopedProcessBlock)
+    };
+
+    // Use in place of juce::ScopedLock for any lock the audio path might reach.
+    struct ScopedLock {
+        explicit ScopedLock(const juce::CriticalSection& lockToUse);
+        ~ScopedLock() {lock.exit();}
+    private:
+        const juce::CriticalSection& lock;
+        JUCE_DECLARE_NON_COPYABLE(ScopedLock)
+    };
+   #else
+    struct ScopedProcessBlock {
+        ScopedProcessBlock(Stats&, int, double) {}
+    };
+    using ScopedLock = juce::ScopedLock;
+   #endif
+}
+#endif /* RealtimeSafety_hpp */
@@ -14,16 +14,23 @@ void RotarySliderWithLabels::paint(juce::Graphics &g){
     auto endAng = degreesToRadians(180.f - 45.f) + MathConstants<float>::twoPi;
     auto range = getRange();
     auto sliderBounds = getSliderBounds();
+    auto enabled = isEnabled();
     
-    getLookAndFeel().drawRotarySlider(g,
-                                      sliderBounds.getX(),
-                                      sliderBounds.getY(),
-                                      sliderBounds.getWidth(),
-                                      sliderBounds.getHeight(),
-                                      jmap(getValue(), range.getStart(), range.getEnd(), 0.0, 1.0) ,
-                                      startAng,
-                                      endAng,
-                                      *this);
+    // Automation repaints every knob continuously, but only the pointer and the value move.
+    staticLayer.draw(g, getLocalBounds(), enabled ? 1 : 0, [&](Graphics& sg){
+        lnf.drawRotarySliderBody(sg, sliderBounds.toFloat(), enabled);
+        drawLabels(sg, sliderBounds, startAng, endAng);
+    });
+    lnf.drawRotarySliderPointer(g,
+                                *this,
+                                sliderBounds.toFloat(),
+                                jmap(getValue(), range.getStart(), range.getEnd(), 0.0, 1.0),
+                                startAng,
+                                endAng);
+}
+
+void RotarySliderWithLabels::drawLabels(juce::Graphics &g, juce::Rectangle<int> sliderBounds, float startAng, float endAng){
+    using namespace juce;
     auto center = sliderBounds.toFloat().getCentre();
     auto radius = sliderBounds.getWidth() * 0.5f;
     g.setColour(Colour(0u,172u, 1u));
@@ -29,7 +29,12 @@ struct RotarySliderWithLabels : juce::Slider {
     int getTextHeight() const {return 14;}
     juce::String getDisplayString() const;
 private:
+    friend struct LookAndFeel;
     LookAndFeel lnf;
+    // Body, ring and range labels; see paint().
+    SpriteCache staticLayer;
+    KnobOverlayCache overlay;
+    void drawLabels(juce::Graphics& g, juce::Rectangle<int> sliderBounds, float startAng, float endAng);
     juce::RangedAudioParameter* param;
     juce::String suffix;
 };
@@ -0,0 +1,78 @@
+//
+//  SpectrumKernels.hpp
+//  Simple EQ
+//
+//  Copyright © 2022 Hsian. All rights reserved.
+//
+
+#ifndef SpectrumKernels_hpp
+#define SpectrumKernels_hpp
+#include <JuceHeader.h>
+
+/*
+ Per-bin loops for the analyzer. They are written branch-free over plain
+ float arrays so the compiler vectorises them (SSE/AVX/NEON, whatever the
+ build targets) without any platform-specific code.
+ */
+namespace SpectrumKernels {
+    /*
+     In place: data[i] = gainToDecibels(data[i] * gain, minusInfinityDb), with
+     log2 approximated from the float's exponent plus a quadratic for the
+     mantissa. Worst-case error is about 0.03 dB, well under a pixel.
+     */
+    inline void magnitudesToDecibels(float* data, int numBins, float gain, float minusInfinityDb){
+        const auto floorGain = juce::Decibels::decibelsToGain(minusInfinityDb, minusInfinityDb - 1.f);
+        constexpr auto decibelsPerOctave = 6.0205999f; // 20 * log10(2)
+        for (int i = 0; i < numBins; ++i){
+            const auto x = juce::jmax(data[i] * gain, floorGain);
+            juce::uint32 bits;
+            std::memcpy(&bits, &x, sizeof(bits));
+            const auto exponent = (float) ((juce::int32) (bits >> 23) - 127);
+            bits = (bits & 0x007fffffu) | 0x3f800000u;
+            float mantissa;
+            std::memcpy(&mantissa, &bits, sizeof(mantissa));
+            const auto log2Mantissa = (-0.34484843f * mantissa + 2.02466578f) * mantissa - 1.67487759f;
+            data[i] = juce::jmax((exponent + log2Mantissa) * decibelsPerOctave, minusInfinityDb);
+        }
+    }
+
+    /*
+     Readable analyzer ballistics, updated once per FFT frame from the newest
+     frame alone, so no history is kept:
+       - the spectrum is an exponential average in dB,
+       - each bin's peak holds for peakHoldTime, then falls at decayRate dB/s
+         until it meets the average again.
+     */
+    struct Ballistics{
+        void prepare(int numBins, float minusInfinityDb){
+            average.assign((size_t) numBins, minusInfinityDb);
+            peaks.assign((size_t) numBins, minusInfinityDb);
+            holdRemaining.assign((size_t) numBins, 0.f);
+        }
+        
+        void process(const float* frameDb, float frameIntervalSeconds){
+            const auto alpha = 1.f - std::exp(-frameIntervalSeconds / averagingTime);
+            const auto decayStep = decayRate * frameIntervalSeconds;
+            const auto numBins = (int) average.size();
+            auto* avg = average.data();
+            auto* peak = peaks.data();
+            auto* hold = holdRemaining.data();
+            for (int i = 0; i < numBins; ++i){
+                const auto newAverage = avg[i] + alpha * (frameDb[i] - avg[i]);
+                const auto rising = newAverage >= peak[i];
+                const auto held = juce::jmax(0.f, hold[i] - frameIntervalSeconds);
+                const auto decayed = juce::jmax(newAverage, peak[i] - decayStep);
+                peak[i] = rising ? newAverage : (held > 0.f ? peak[i] : decayed);
+                hold[i] = rising ? peakHoldTime : held;
+                avg[i] = newAverage;
+            }
+        }
+        
+        const std::vector<float>& getAverage() const {return average;}
+        const std::vector<float>& getPeaks() const {return peaks;}
+    private:
+        static constexpr float averagingTime = 0.1f, peakHoldTime = 1.f, decayRate = 12.f;
+        std::vector<float> average, peaks, holdRemaining;
+    };
+}
+#endif /* SpectrumKernels_hpp */
@@ -0,0 +1,24 @@
+//
+//  Main.cpp
+//  Simple EQ Tests
+//
+//  Copyright © 2022 Hsian. All rights reserved.
+//
+
+#include <JuceHeader.h>
+
+/*
+ Runs the "Simple EQ" unit tests and exits with 1 if any of them failed.
+ */
+int main (int, char*[])
+{
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure(false);
+    runner.runTestsInCategory("Simple EQ");
+
+    int numFailures = 0;
+    for (int i = 0; i < runner.getNumResults(); ++i){
+        numFailures += runner.getResult(i)->failures;
+    }
+    return numFailures > 0 ? 1 : 0;
+}
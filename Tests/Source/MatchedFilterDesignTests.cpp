@@ -0,0 +1,90 @@
+//
+//  MatchedFilterDesignTests.cpp
+//  Simple EQ Tests
+//
+//  Copyright © 2022 Hsian. All rights reserved.
+//
+
+#include <JuceHeader.h>
+#include "../../Source/MatchedFilterDesign.hpp"
+
+namespace {
+    // |H(jw)| of the prototype behind IIR::Coefficients::makePeakFilter:
+    // (s^2 + s A / Q + 1) / (s^2 + s / (A Q) + 1), with A = sqrt(gain).
+    double getAnalogPeakMagnitude(double frequency, double centreFrequency, double quality, double gainFactor){
+        const auto A = std::sqrt(gainFactor);
+        const auto w = frequency / centreFrequency;
+        const auto real = (1.0 - w * w) * (1.0 - w * w);
+        return std::sqrt((real + juce::square(w * A / quality)) / (real + juce::square(w / (A * quality))));
+    }
+
+    // Worst deviation from the prototype in dB, 20 Hz to 20 kHz (or Nyquist) on a log grid.
+    double getPeakErrorDecibels(double sampleRate, float frequency, float quality, float gainDecibels){
+        const auto gainFactor = juce::Decibels::decibelsToGain(gainDecibels);
+        auto coefficients = makeMatchedPeakFilter<double>(sampleRate, frequency, quality, gainFactor);
+        const auto top = juce::jmin(20000.0, 0.49 * sampleRate);
+        constexpr int numPoints = 2000;
+        double worst = 0.0;
+        for (int i = 0; i <= numPoints; ++i){
+            const auto f = 20.0 * std::pow(top / 20.0, i / (double) numPoints);
+            const auto digital = coefficients->getMagnitudeForFrequency(f, sampleRate);
+            const auto analog = getAnalogPeakMagnitude(f, frequency, quality, gainFactor);
+            worst = juce::jmax(worst, std::abs(juce::Decibels::gainToDecibels(digital / analog, -300.0)));
+        }
+        return worst;
+    }
+
+    bool isStable(const juce::dsp::IIR::Coefficients<double>& coefficients){
+        auto* c = coefficients.getRawCoefficients();
+        const auto a1 = c[3], a2 = c[4];
+        return std::abs(a2) < 1.0 && std::abs(a1) < 1.0 + a2
+            && std::all_of(c, c + 5, [](double value){return std::isfinite(value);});
+    }
+}
+
+struct MatchedFilterDesignTests : juce::UnitTest {
+    MatchedFilterDesignTests() : juce::UnitTest("Matched filter design", "Simple EQ") {}
+
+    void runTest() override {
+        beginTest("Peak error bounds near Nyquist");
+        // Measured values, with a little headroom; a regression shows up as a bigger error.
+        expectLessThan(getPeakErrorDecibels(44100.0, 19000.f, 0.707f, 24.f), 1.8);
+        expectLessThan(getPeakErrorDecibels(44100.0, 19000.f, 0.707f, -24.f), 2.3);
+        expectLessThan(getPeakErrorDecibels(96000.0, 19000.f, 0.707f, -24.f), 0.25);
+        expectLessThan(getPeakErrorDecibels(48000.0, 1000.f, 1.f, 12.f), 0.02);
+
+        beginTest("Peak error bounds over the parameter range");
+        const std::pair<double, double> worstErrors[] {{44100.0, 4.2}, {48000.0, 3.1}, {88200.0, 0.52}, {96000.0, 0.42}, {192000.0, 0.1}};
+        for (auto [sampleRate, bound]: worstErrors){
+            double worst = 0.0;
+            for (auto frequency: {20.f, 100.f, 1000.f, 5000.f, 10000.f, 15000.f, 19000.f, 20000.f}){
+                for (auto quality: {0.1f, 0.707f, 1.f, 4.f, 10.f}){
+                    for (auto gain: {-24.f, -12.f, -6.f, 6.f, 12.f, 24.f}){
+                        worst = juce::jmax(worst, getPeakErrorDecibels(sampleRate, frequency, quality, gain));
+                    }
+                }
+            }
+            logMessage(juce::String(sampleRate) + " Hz: worst peak error " + juce::String(worst, 3) + " dB");
+            expectLessThan(worst, bound);
+        }
+
+        beginTest("Gain at the centre frequency");
+        for (auto gain: {-24.f, -6.f, 6.f, 24.f}){
+            auto coefficients = makeMatchedPeakFilter<double>(44100.0, 19000.f, 0.707f, juce::Decibels::decibelsToGain(gain));
+            expectWithinAbsoluteError(juce::Decibels::gainToDecibels(coefficients->getMagnitudeForFrequency(19000.0, 44100.0)),
+                                      (double) gain, 0.01);
+        }
+
+        beginTest("Bands above Nyquist");
+        // A 20 kHz band at 32 kHz is designed just below Nyquist rather than with an invalid w0.
+        expect(isStable(*makeMatchedPeakFilter<double>(32000.0, 20000.f, 0.707f, juce::Decibels::decibelsToGain(-24.f))));
+        for (auto* section: designMatchedButterworthLowPass<double>(20000.f, 32000.0, 8)){
+            expect(isStable(*section));
+        }
+        for (auto* section: designMatchedButterworthHighPass<double>(20000.f, 32000.0, 8)){
+            expect(isStable(*section));
+        }
+    }
+};
+
+static MatchedFilterDesignTests matchedFilterDesignTests;